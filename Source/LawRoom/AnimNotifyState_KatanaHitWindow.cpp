@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AnimNotifyState_KatanaHitWindow.h"
+#include "KatanaHitDetectionComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+UKatanaHitDetectionComponent* UAnimNotifyState_KatanaHitWindow::GetHitDetection(USkeletalMeshComponent* MeshComp) const
+{
+	AActor* Owner = MeshComp ? MeshComp->GetOwner() : nullptr;
+	return Owner ? Owner->FindComponentByClass<UKatanaHitDetectionComponent>() : nullptr;
+}
+
+void UAnimNotifyState_KatanaHitWindow::NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration)
+{
+	Super::NotifyBegin(MeshComp, Animation, TotalDuration);
+
+	if (UKatanaHitDetectionComponent* HitDetection = GetHitDetection(MeshComp))
+	{
+		HitDetection->BeginHitWindow();
+	}
+}
+
+void UAnimNotifyState_KatanaHitWindow::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation)
+{
+	Super::NotifyEnd(MeshComp, Animation);
+
+	if (UKatanaHitDetectionComponent* HitDetection = GetHitDetection(MeshComp))
+	{
+		HitDetection->EndHitWindow();
+	}
+}
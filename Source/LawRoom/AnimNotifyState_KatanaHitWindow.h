@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNotifies/AnimNotifyState.h"
+#include "AnimNotifyState_KatanaHitWindow.generated.h"
+
+// opens the katana hit detection for the duration of the notify: it is placed on the InjectionShotAnim montage
+UCLASS(meta = (DisplayName = "Katana Hit Window"))
+class LAWROOM_API UAnimNotifyState_KatanaHitWindow : public UAnimNotifyState
+{
+	GENERATED_BODY()
+
+private:
+	class UKatanaHitDetectionComponent* GetHitDetection(USkeletalMeshComponent* MeshComp) const;
+
+public:
+	virtual void NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration) override;
+	virtual void NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation) override;
+};
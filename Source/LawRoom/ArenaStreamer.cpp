@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ArenaStreamer.h"
+#include "LawRoom.h"
+#include "LawRoomGameMode.h"
+#include "RoomAbilityComponent.h"
+#include "Engine/Level.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "UObject/UObjectHash.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Arena Resident Cells"), STAT_ArenaResidentCells, STATGROUP_LawRoom);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Arena Last Cell Load Latency (ms)"), STAT_ArenaCellLoadLatency, STATGROUP_LawRoom);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Arena Room Cast Stall (ms)"), STAT_ArenaRoomStall, STATGROUP_LawRoom);
+
+// Sets default values
+AArenaStreamer::AArenaStreamer()
+{
+	// the cells are updated every UpdateInterval, not every frame
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+// Called when the game starts or when spawned
+void AArenaStreamer::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorTickInterval(UpdateInterval);
+
+	// the server and every client stream the cells near their own viewers, the levels are the same on all of them
+	for (FArenaCell& Cell : Cells)
+	{
+		Cell.Streaming = FindCellStreaming(Cell);
+		if (Cell.Streaming)
+		{
+			Cell.Streaming->OnLevelShown.AddUniqueDynamic(this, &AArenaStreamer::OnCellShown);
+		}
+		else if (!Cell.Level.IsNull())
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("Arena cell %s is not a streaming level of the persistent map, it is never loaded"), *Cell.Level.ToString());
+		}
+	}
+
+	ALawRoomGameMode* GameMode = GetWorld()->GetAuthGameMode<ALawRoomGameMode>();
+	if (GameMode)
+	{
+		GameMode->SetArenaStreamer(this);
+	}
+}
+
+// Called every UpdateInterval
+void AArenaStreamer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	GatherViewersAndRooms();
+
+	int32 ResidentCells = 0;
+	for (FArenaCell& Cell : Cells)
+	{
+		Cell.bIsPinned = IsReachedByRoom(Cell);
+
+		float ViewDistanceSquared = GetViewDistanceSquared(Cell);
+		if (Cell.bIsPinned || (ViewDistanceSquared < FMath::Square(LoadDistance)))
+		{
+			LoadCell(Cell);
+		}
+		else if (ViewDistanceSquared > FMath::Square(UnloadDistance))
+		{
+			UnloadCell(Cell);
+		}
+
+		if (IsCellResident(Cell))
+		{
+			ResidentCells++;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ArenaResidentCells, ResidentCells);
+}
+
+void AArenaStreamer::GatherViewersAndRooms()
+{
+	ViewLocations.Reset();
+	Rooms.Reset();
+
+	TArray<APawn*> Users;
+	URoomAbilityComponent::GetRoomUsers(GetWorld(), Users);
+	for (APawn* Pawn : Users)
+	{
+		ViewLocations.Add(Pawn->GetActorLocation());
+
+		URoomAbilityComponent* RoomAbility = Pawn->FindComponentByClass<URoomAbilityComponent>();
+		FSphere RoomSphere;
+		if (RoomAbility && RoomAbility->GetRoomSphere(RoomSphere))
+		{
+			Rooms.Add(RoomSphere);
+		}
+	}
+}
+
+ULevelStreaming* AArenaStreamer::FindCellStreaming(const FArenaCell& Cell) const
+{
+	if (Cell.Level.IsNull()) { return nullptr; }
+
+	// PIE prefixes the streaming level packages
+	FString PackageName = Cell.Level.GetLongPackageName();
+	for (ULevelStreaming* Streaming : GetWorld()->GetStreamingLevels())
+	{
+		if (Streaming && (UWorld::RemovePIEPrefix(Streaming->GetWorldAssetPackageName()) == PackageName))
+		{
+			return Streaming;
+		}
+	}
+
+	return nullptr;
+}
+
+float AArenaStreamer::GetViewDistanceSquared(const FArenaCell& Cell) const
+{
+	float MinDistance = MAX_flt;
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		MinDistance = FMath::Min(MinDistance, Cell.Bounds.ComputeSquaredDistanceToPoint(ViewLocation));
+	}
+
+	return MinDistance;
+}
+
+bool AArenaStreamer::IsReachedByRoom(const FArenaCell& Cell) const
+{
+	for (const FSphere& Room : Rooms)
+	{
+		if (FMath::SphereAABBIntersection(Room, Cell.Bounds))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool AArenaStreamer::IsCellResident(const FArenaCell& Cell) const
+{
+	return Cell.Streaming && Cell.Streaming->IsLevelLoaded() && Cell.Streaming->IsLevelVisible();
+}
+
+void AArenaStreamer::LoadCell(FArenaCell& Cell)
+{
+	if (!Cell.Streaming) { return; }
+
+	if (!Cell.Streaming->ShouldBeLoaded())
+	{
+		Cell.Streaming->SetShouldBeLoaded(true);
+		Cell.Streaming->SetShouldBeVisible(true);
+		Cell.RequestTime = FPlatformTime::Seconds();
+	}
+
+	// the cells a room reaches go first
+	Cell.Streaming->SetPriority(Cell.bIsPinned ? 1 : 0);
+}
+
+void AArenaStreamer::UnloadCell(FArenaCell& Cell)
+{
+	if (!Cell.Streaming || !Cell.Streaming->ShouldBeLoaded()) { return; }
+
+	Cell.Streaming->SetShouldBeVisible(false);
+	Cell.Streaming->SetShouldBeLoaded(false);
+	Cell.RequestTime = 0.0;
+}
+
+int64 AArenaStreamer::GetCellResidentBytes(const FArenaCell& Cell) const
+{
+	ULevel* Level = Cell.Streaming ? Cell.Streaming->GetLoadedLevel() : nullptr;
+	if (!Level) { return 0; }
+
+	TArray<UObject*> Objects;
+	GetObjectsWithOuter(Level->GetOutermost(), Objects, true);
+
+	int64 Bytes = 0;
+	for (UObject* Object : Objects)
+	{
+		FArchiveCountMem CountMem(Object);
+		Bytes += CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	return Bytes;
+}
+
+void AArenaStreamer::OnCellShown()
+{
+	for (FArenaCell& Cell : Cells)
+	{
+		if ((Cell.RequestTime != 0.0) && IsCellResident(Cell))
+		{
+			Cell.LastLoadLatencyMs = (float)((FPlatformTime::Seconds() - Cell.RequestTime) * 1000.0);
+			Cell.RequestTime = 0.0;
+
+			SET_FLOAT_STAT(STAT_ArenaCellLoadLatency, Cell.LastLoadLatencyMs);
+			UE_LOG(LogLawRoom, Log, TEXT("Arena cell %s resident after %.1f ms"), *Cell.Level.GetAssetName(), Cell.LastLoadLatencyMs);
+		}
+	}
+}
+
+void AArenaStreamer::RequestCellsInSphere(const FSphere& Sphere)
+{
+	for (FArenaCell& Cell : Cells)
+	{
+		if (FMath::SphereAABBIntersection(Sphere, Cell.Bounds))
+		{
+			Cell.bIsPinned = true;
+			LoadCell(Cell);
+		}
+	}
+}
+
+float AArenaStreamer::MakeCellsResident(const FSphere& Sphere)
+{
+	RequestCellsInSphere(Sphere);
+
+	bool bMustFlush = false;
+	for (const FArenaCell& Cell : Cells)
+	{
+		if (Cell.Streaming && FMath::SphereAABBIntersection(Sphere, Cell.Bounds) && !IsCellResident(Cell))
+		{
+			bMustFlush = true;
+		}
+	}
+
+	if (!bMustFlush) { return 0.f; }
+
+	// the room is done spawning and its cells are still streaming in: finish them now, the enemies begin play on the way
+	uint32 StartCycles = FPlatformTime::Cycles();
+	GetWorld()->FlushLevelStreaming(EFlushLevelStreamingType::Full);
+	float StallMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	SET_FLOAT_STAT(STAT_ArenaRoomStall, StallMs);
+	UE_LOG(LogLawRoom, Warning, TEXT("Room cast waited %.1f ms for its arena cells to stream in"), StallMs);
+
+	return StallMs;
+}
+
+void AArenaStreamer::LogCells() const
+{
+	int64 TotalBytes = 0;
+	for (const FArenaCell& Cell : Cells)
+	{
+		// measured here only: serializing every object of the level is far too slow for the frame the level is shown
+		bool bIsResident = IsCellResident(Cell);
+		int64 Bytes = bIsResident ? GetCellResidentBytes(Cell) : 0;
+		TotalBytes += Bytes;
+
+		const TCHAR* State = bIsResident ? TEXT("resident") : ((Cell.RequestTime != 0.0) ? TEXT("loading") : TEXT("unloaded"));
+		UE_LOG(LogLawRoom, Display, TEXT("Arena cell %s: %s%s, last load %.1f ms, %lld KB"),
+			*Cell.Level.GetAssetName(), State, Cell.bIsPinned ? TEXT(" (room)") : TEXT(""), Cell.LastLoadLatencyMs, Bytes / 1024);
+	}
+
+	UE_LOG(LogLawRoom, Display, TEXT("Arena resident cells: %lld KB"), TotalBytes / 1024);
+}
+
+static FAutoConsoleCommandWithWorld CellReportCommand(
+	TEXT("LawRoom.CellReport"),
+	TEXT("Logs the state, last load latency and resident memory of every arena cell"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AArenaStreamer> It(World); It; ++It)
+		{
+			It->LogCells();
+		}
+	})
+);
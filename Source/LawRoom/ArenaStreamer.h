@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ArenaStreamer.generated.h"
+
+// a streamable part of the arena: its geometry and enemy group live in their own level, a streaming level of the persistent map
+// so it has the same name on the server and every client and its replicated enemies resolve across the network
+USTRUCT()
+struct FArenaCell
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Cell")
+	// must be in the streaming levels of the persistent map, without Initially Loaded and Initially Visible
+	TSoftObjectPtr<UWorld> Level;
+
+	UPROPERTY(EditAnywhere, Category = "Cell")
+	// world space bounds of the cell, used to decide when it is loaded
+	FBox Bounds = FBox(ForceInit);
+
+	UPROPERTY(Transient)
+	// the streaming level of the persistent map found for Level at begin play
+	class ULevelStreaming* Streaming = nullptr;
+
+	// a room reaches the cell, it is kept loaded whatever the player distance
+	bool bIsPinned = false;
+
+	// real time of the load request, 0 when no load is pending
+	double RequestTime = 0.0;
+
+	float LastLoadLatencyMs = 0.f;
+};
+
+// loads the arena cells near the players and the rooms, and unloads the distant ones
+UCLASS()
+class LAWROOM_API AArenaStreamer : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	TArray<FArenaCell> Cells;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	// cells closer than this to a player are loaded
+	float LoadDistance = 4000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	// cells farther than this from every player and outside every room are unloaded, bigger than LoadDistance to avoid reloading
+	float UnloadDistance = 6000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	// seconds between two streaming updates
+	float UpdateInterval = 0.25f;
+
+	// player locations and active rooms of this update
+	TArray<FVector> ViewLocations;
+	TArray<FSphere> Rooms;
+
+private:
+	void GatherViewersAndRooms();
+
+	// the streaming level of the persistent map for the cell level, null when the map does not have it
+	class ULevelStreaming* FindCellStreaming(const FArenaCell& Cell) const;
+
+	// squared distance from the cell bounds to the closest player
+	float GetViewDistanceSquared(const FArenaCell& Cell) const;
+
+	bool IsReachedByRoom(const FArenaCell& Cell) const;
+
+	void LoadCell(FArenaCell& Cell);
+	void UnloadCell(FArenaCell& Cell);
+
+	// size of the objects of the cell level package, the assets shared with other levels are not counted;
+	// serializes every object of the level, only LawRoom.CellReport calls it
+	int64 GetCellResidentBytes(const FArenaCell& Cell) const;
+
+	UFUNCTION()
+	// records the load latency of the cells that just became visible
+	void OnCellShown();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+public:
+	// Sets default values for this actor's properties
+	AArenaStreamer();
+
+	// Called every UpdateInterval
+	virtual void Tick(float DeltaTime) override;
+
+	// starts loading the cells reached by a room being cast
+	void RequestCellsInSphere(const FSphere& Sphere);
+
+	// blocks until the cells reached by the room are loaded and visible, returns the time spent blocking in ms
+	float MakeCellsResident(const FSphere& Sphere);
+
+	// the cell level is loaded and visible: its enemies have begun play
+	bool IsCellResident(const FArenaCell& Cell) const;
+
+	// logs the state, last load latency and resident memory of every cell
+	void LogCells() const;
+};
@@ -4,8 +4,49 @@
 #include "Enemy.h"
 #include "Components/SplineComponent.h"
 #include "Components/WidgetComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "EnemyMovementComponent.h"
+#include "Engine/CollisionProfile.h"
 #include "TimerManager.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "AIController.h"
+#include "EnemyAIScheduler.h"
+#include "LawRoomGameMode.h"
+#include "LawRoom.h"
+#include "LawRoomMemory.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+static TAutoConsoleVariable<float> CVarEnemyAnimTickInterval(
+	TEXT("LawRoom.Enemy.AnimTickInterval"),
+	0.f,
+	TEXT("Seconds between two animation updates of the enemies, 0 for every frame (LawRoom scalability)"));
+
+// applies a new animation tick interval to the enemies already spawned
+static FAutoConsoleVariableSink EnemyAnimTickIntervalSink(FConsoleCommandDelegate::CreateLambda([]()
+{
+	static float AppliedInterval = 0.f;
+	float Interval = CVarEnemyAnimTickInterval.GetValueOnGameThread();
+	if (Interval == AppliedInterval) { return; }
+
+	AppliedInterval = Interval;
+	for (TObjectIterator<AEnemy> It; It; ++It)
+	{
+		// the enemies placed in editor worlds would save the interval with the map
+		if (!It->IsTemplate() && It->GetWorld() && It->GetWorld()->IsGameWorld())
+		{
+			It->UpdateAnimTickInterval();
+		}
+	}
+}));
+
+static TAutoConsoleVariable<float> CVarCrosshairUpdateRate(
+	TEXT("LawRoom.Crosshair.UpdateRate"),
+	0.f,
+	TEXT("Updates per second of the crosshair moving along its path, 0 for every frame (LawRoom scalability)"));
 
 // Sets default values
 AEnemy::AEnemy()
@@ -13,16 +54,47 @@ AEnemy::AEnemy()
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
+	// the capsule and mesh keep the ACharacter names so the enemy bp keeps their settings
+	CapsuleComponent = CreateDefaultSubobject<UCapsuleComponent>(ACharacter::CapsuleComponentName);
+	CapsuleComponent->InitCapsuleSize(34.f, 88.f);
+	CapsuleComponent->SetCollisionProfileName(UCollisionProfile::Pawn_ProfileName);
+	CapsuleComponent->SetCanEverAffectNavigation(false);
+	RootComponent = CapsuleComponent;
+
+	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(ACharacter::MeshComponentName);
+	Mesh->SetupAttachment(CapsuleComponent);
+	Mesh->SetCollisionProfileName("CharacterMesh");
+	Mesh->SetGenerateOverlapEvents(false);
+	Mesh->SetCanEverAffectNavigation(false);
+	Mesh->AlwaysLoadOnClient = true;
+	Mesh->AlwaysLoadOnServer = true;
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+
+	Movement = CreateOptionalDefaultSubobject<UEnemyMovementComponent>("Movement");
+	if (Movement)
+	{
+		Movement->UpdatedComponent = CapsuleComponent;
+	}
+
 	Crosshair = CreateDefaultSubobject<UWidgetComponent>("Crosshair");
 	Crosshair->bVisible = false;
 	Crosshair->SetWidgetSpace(EWidgetSpace::Screen);
+
+	// the enemy decisions are made by the AEnemyAIScheduler, the controller only follows its move requests
+	AIControllerClass = AAIController::StaticClass();
+	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
 }
 
 // Called when the game starts or when spawned
 void AEnemy::BeginPlay()
 {
-	Super::BeginPlay();
+	{
+		// the crosshair widget is created when its component begins play
+		LAWROOM_LLM_SCOPE(CrosshairWidgets);
+		Super::BeginPlay();
+	}
 	
+#if LAWROOM_WITH_COSMETICS
 	// ensures that the crosshair path is set  
 	ensure(CrosshairPath);
 
@@ -31,6 +103,38 @@ void AEnemy::BeginPlay()
 		FVector InitLocation = CrosshairPath->GetLocationAtSplinePoint(0, ESplineCoordinateSpace::World);
 		Crosshair->SetWorldLocation(InitLocation);
 	}
+#endif
+
+	if (AEnemyAIScheduler* AIScheduler = GetAIScheduler())
+	{
+		LAWROOM_LLM_SCOPE(AI);
+		AIScheduler->RegisterEnemy(this);
+	}
+
+	UpdateAnimTickInterval();
+}
+
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (AEnemyAIScheduler* AIScheduler = FindAIScheduler())
+	{
+		AIScheduler->UnregisterEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+AEnemyAIScheduler* AEnemy::GetAIScheduler() const
+{
+	// the game mode only exists on the server
+	ALawRoomGameMode* GameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALawRoomGameMode>() : nullptr;
+	return GameMode ? GameMode->GetEnemyAIScheduler() : nullptr;
+}
+
+AEnemyAIScheduler* AEnemy::FindAIScheduler() const
+{
+	ALawRoomGameMode* GameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALawRoomGameMode>() : nullptr;
+	return GameMode ? GameMode->FindEnemyAIScheduler() : nullptr;
 }
 
 // Called every frame
@@ -40,8 +144,17 @@ void AEnemy::Tick(float DeltaTime)
 
 }
 
+UPawnMovementComponent* AEnemy::GetMovementComponent() const
+{
+	return Movement;
+}
+
 void AEnemy::MoveCrosshair(float Duration)
 {
+#if LAWROOM_WITH_COSMETICS
+	// nobody sees the crosshair on a dedicated server
+	if (IsNetMode(NM_DedicatedServer)) { return; }
+
 	if (CrosshairPath)
 	{
 		FVector InitLocation = CrosshairPath->GetLocationAtSplinePoint(0, ESplineCoordinateSpace::World);
@@ -69,8 +182,90 @@ void AEnemy::MoveCrosshair(float Duration)
 		}
 	});
 
-	GetWorld()->GetTimerManager().SetTimer(TimerHandle, CrosshairMoveDel, GetWorld()->GetDeltaSeconds(), true);
+	float UpdateRate = CVarCrosshairUpdateRate.GetValueOnGameThread();
+	float UpdateInterval = (UpdateRate > 0.f) ? 1.f / UpdateRate : GetWorld()->GetDeltaSeconds();
+	GetWorld()->GetTimerManager().SetTimer(TimerHandle, CrosshairMoveDel, UpdateInterval, true);
 	Crosshair->SetVisibility(true);
+#endif
+}
+
+void AEnemy::PrewarmRagdoll()
+{
+	USkeletalMeshComponent* EnemyMesh = GetMesh();
+	if (bIsRagdollPrewarmed || bIsDead || !EnemyMesh) { return; }
+
+	LAWROOM_LLM_SCOPE(Ragdoll);
+
+	// the rag doll profile creates the physics shapes with the filtering they will have once dead
+	MeshCollisionProfile = EnemyMesh->GetCollisionProfileName();
+	EnemyMesh->SetCollisionProfileName("Ragdoll");
+	if (!EnemyMesh->IsPhysicsStateCreated())
+	{
+		EnemyMesh->RecreatePhysicsState();
+	}
+
+	// keep following the animation until the kill
+	EnemyMesh->SetAllBodiesBelowSimulatePhysics(FName("pelvis"), false, true);
+	EnemyMesh->PutAllRigidBodiesToSleep();
+
+	bIsRagdollPrewarmed = true;
+}
+
+void AEnemy::ReleaseRagdoll()
+{
+	if (!bIsRagdollPrewarmed || bIsDead) { return; }
+
+	GetMesh()->SetCollisionProfileName(MeshCollisionProfile);
+	bIsRagdollPrewarmed = false;
+}
+
+void AEnemy::StartRagdoll()
+{
+	Mesh->SetAllBodiesBelowSimulatePhysics(FName("pelvis"), true, true);
+	Mesh->SetAllBodiesBelowPhysicsBlendWeight(FName("pelvis"), 1.f);
+
+	RagdollStartTime = GetWorld()->GetTimeSeconds();
+}
+
+float AEnemy::GetRagdollSimulationTime() const
+{
+	return GetWorld()->GetTimeSeconds() - RagdollStartTime;
+}
+
+void AEnemy::FreezeRagdoll()
+{
+	if (!bIsDead) { return; }
+
+	// the bones keep the pose the simulation left them in
+	Mesh->bNoSkeletonUpdate = true;
+	Mesh->SetAllBodiesSimulatePhysics(false);
+	Mesh->SetComponentTickEnabled(false);
+}
+
+void AEnemy::DropRagdoll()
+{
+	if (!bIsDead) { return; }
+
+	// a rag doll frozen mid air would hang there: move the enemy on the ground below the pelvis instead
+	FVector Pelvis = Mesh->GetBoneLocation(FName("pelvis"));
+	FHitResult Hit;
+	if (GetWorld()->LineTraceSingleByObjectType(Hit, Pelvis, Pelvis - FVector(0.f, 0.f, 10000.f), FCollisionObjectQueryParams(ECC_WorldStatic)))
+	{
+		SetActorLocation(Hit.Location + FVector(0.f, 0.f, CapsuleComponent->GetScaledCapsuleHalfHeight()), false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	Mesh->SetAllBodiesSimulatePhysics(false);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Mesh->SetComponentTickEnabled(false);
+	SetActorHiddenInGame(true);
+}
+
+void AEnemy::UpdateAnimTickInterval()
+{
+	// a dead enemy is frozen or driven by its rag doll
+	if (bIsDead) { return; }
+
+	Mesh->SetComponentTickInterval(FMath::Max(CVarEnemyAnimTickInterval.GetValueOnGameThread(), 0.f));
 }
 
 void AEnemy::LookAt(AActor* Player)
@@ -78,4 +273,3 @@ void AEnemy::LookAt(AActor* Player)
 	FRotator NewRotation = UKismetMathLibrary::FindLookAtRotation(this->GetActorLocation(), Player->GetActorLocation());
 	SetActorRotation(NewRotation);
 }
-
@@ -3,18 +3,38 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GameFramework/Character.h"
+#include "GameFramework/Pawn.h"
 #include "Enemy.generated.h"
 
+// lean enemy pawn: a capsule, a skeletal mesh and an optional kinematic mover, no character movement
 UCLASS()
-class LAWROOM_API AEnemy : public ACharacter
+class LAWROOM_API AEnemy : public APawn
 {
 	GENERATED_BODY()
 
 private:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Enemy", meta = (AllowPrivateAccess = "true"))
+	class UCapsuleComponent* CapsuleComponent;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Enemy", meta = (AllowPrivateAccess = "true"))
+	class USkeletalMeshComponent* Mesh;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Enemy", meta = (AllowPrivateAccess = "true"))
+	// optional: enemies that never move can remove it in their bp
+	class UEnemyMovementComponent* Movement;
+
 	// is the enemy dead or not
 	bool bIsDead = false;
 
+	// are the rag doll bodies already created
+	bool bIsRagdollPrewarmed = false;
+
+	// the mesh collision profile the prewarm replaced, put back by ReleaseRagdoll
+	FName MeshCollisionProfile;
+
+	// world time the rag doll started to simulate at
+	float RagdollStartTime = 0.f;
+
 	UPROPERTY(BlueprintReadWrite, meta = (AllowPrivateAccess = "true"))
 	// the path that the crosshair follows when aims at the enemy : it is set in Enemy bp construction script
 	class USplineComponent* CrosshairPath;
@@ -26,6 +46,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Sets default values for this character's properties
 	AEnemy();
@@ -33,8 +55,35 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	virtual class UPawnMovementComponent* GetMovementComponent() const override;
+
+	FORCEINLINE class UCapsuleComponent* GetCapsuleComponent() const { return CapsuleComponent; }
+	FORCEINLINE class USkeletalMeshComponent* GetMesh() const { return Mesh; }
+
 	FORCEINLINE bool GetIsDead() const { return bIsDead; }
 	FORCEINLINE void SetIsDead(bool Value) { bIsDead = Value; }
+	FORCEINLINE bool GetIsRagdollPrewarmed() const { return bIsRagdollPrewarmed; }
+
+	// creates the rag doll bodies ahead of the death, kinematic and asleep, so the kill only switches them to simulated
+	void PrewarmRagdoll();
+	// puts the mesh collision back to its default when the enemy is not about to die anymore
+	void ReleaseRagdoll();
+	// the dead enemy rag doll starts to simulate now
+	void StartRagdoll();
+	// seconds the rag doll has simulated for
+	float GetRagdollSimulationTime() const;
+	// stops simulating the dead enemy rag doll, its last pose is kept
+	void FreezeRagdoll();
+	// stops simulating the dead enemy rag doll, puts it on the ground below it and hides it: for rag dolls still falling
+	void DropRagdoll();
+
+	// animation tick interval of LawRoom.Enemy.AnimTickInterval
+	void UpdateAnimTickInterval();
+
+	// the scheduler that runs this enemy decisions (server only), spawned on the first call
+	class AEnemyAIScheduler* GetAIScheduler() const;
+	// same, but null when it was not spawned, safe during teardown
+	class AEnemyAIScheduler* FindAIScheduler() const;
 
 	void MoveCrosshair(float Duration);
 	void LookAt(AActor* Player);
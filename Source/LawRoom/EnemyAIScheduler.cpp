@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyAIScheduler.h"
+#include "LawRoom.h"
+#include "Enemy.h"
+#include "RoomAbilityComponent.h"
+#include "LawRoomFrameCapture.h"
+#include "AIController.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy AI Update"), STAT_EnemyAIUpdate, STATGROUP_LawRoom);
+DECLARE_CYCLE_STAT(TEXT("Enemy AI Move Requests"), STAT_EnemyAIMoveRequests, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy AI Registered"), STAT_EnemyAIRegistered, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy AI Updated"), STAT_EnemyAIUpdated, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy AI Move Requests"), STAT_EnemyAIMoveRequestCount, STATGROUP_LawRoom);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Enemy AI Max Latency (ms)"), STAT_EnemyAIMaxLatency, STATGROUP_LawRoom);
+
+// Sets default values
+AEnemyAIScheduler::AEnemyAIScheduler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// decide before the enemies move this frame
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+void AEnemyAIScheduler::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy && !EnemyIndices.Contains(Enemy))
+	{
+		EnemyIndices.Add(Enemy, Enemies.Add(Enemy));
+		States.Add(EEnemyAIState::Idle);
+		MoveTargets.Add(Enemy->GetActorLocation());
+		LastUpdateTimes.Add(GetWorld()->GetTimeSeconds());
+		RoomCounts.Add(0);
+	}
+}
+
+void AEnemyAIScheduler::UnregisterEnemy(AEnemy* Enemy)
+{
+	int32 Index = INDEX_NONE;
+	if (EnemyIndices.RemoveAndCopyValue(Enemy, Index))
+	{
+		if (RoomCounts[Index] > 0)
+		{
+			RoomEnemies.RemoveSingleSwap(Enemy, false);
+		}
+
+		Enemies.RemoveAtSwap(Index, 1, false);
+		States.RemoveAtSwap(Index, 1, false);
+		MoveTargets.RemoveAtSwap(Index, 1, false);
+		LastUpdateTimes.RemoveAtSwap(Index, 1, false);
+		RoomCounts.RemoveAtSwap(Index, 1, false);
+
+		// the last enemy took the index
+		if (Enemies.IsValidIndex(Index))
+		{
+			EnemyIndices.Add(Enemies[Index], Index);
+		}
+	}
+}
+
+void AEnemyAIScheduler::OnEnemyEnteredRoom(AEnemy* Enemy)
+{
+	const int32* Index = EnemyIndices.Find(Enemy);
+	if (Index && (RoomCounts[*Index]++ == 0))
+	{
+		RoomEnemies.Add(Enemy);
+	}
+}
+
+void AEnemyAIScheduler::OnEnemyLeftRoom(AEnemy* Enemy)
+{
+	const int32* Index = EnemyIndices.Find(Enemy);
+	if (Index && (RoomCounts[*Index] > 0) && (--RoomCounts[*Index] == 0))
+	{
+		RoomEnemies.RemoveSingleSwap(Enemy, false);
+	}
+}
+
+EEnemyAIState AEnemyAIScheduler::GetEnemyState(const AEnemy* Enemy) const
+{
+	const int32* Index = EnemyIndices.Find(Enemy);
+	return Index ? States[*Index] : EEnemyAIState::Idle;
+}
+
+// Called every frame
+void AEnemyAIScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAIUpdate);
+	LAWROOM_FRAME_SCOPE(AI);
+	SET_DWORD_STAT(STAT_EnemyAIRegistered, Enemies.Num());
+
+	if (Enemies.Num() == 0) { return; }
+
+	// players and active rooms are gathered once for all the updated enemies
+	TArray<APawn*> Players;
+	TArray<FSphere> Rooms;
+	URoomAbilityComponent::GetRoomUsers(GetWorld(), Players);
+	for (APawn* Pawn : Players)
+	{
+		URoomAbilityComponent* RoomAbility = Pawn->FindComponentByClass<URoomAbilityComponent>();
+		FSphere RoomSphere;
+		if (RoomAbility && RoomAbility->GetRoomSphere(RoomSphere))
+		{
+			Rooms.Add(RoomSphere);
+		}
+	}
+
+	float Now = GetWorld()->GetTimeSeconds();
+	int32 Budget = FMath::Min(EnemiesPerFrame, Enemies.Num());
+	UpdatedThisFrame.Reset();
+
+	// enemies inside a room first, they are the ones the player is looking at
+	int32 RoomBudget = FMath::Min(FMath::RoundToInt(Budget * RoomPriorityShare), RoomEnemies.Num());
+	for (int32 Step = 0; Step < RoomBudget; Step++)
+	{
+		NextRoomEnemy = NextRoomEnemy % RoomEnemies.Num();
+		UpdatedThisFrame.Add(EnemyIndices.FindChecked(RoomEnemies[NextRoomEnemy]));
+		NextRoomEnemy++;
+	}
+
+	// then everyone else in turn
+	for (int32 Step = 0; (Step < Enemies.Num()) && (UpdatedThisFrame.Num() < Budget); Step++)
+	{
+		int32 Index = (NextEnemy + Step) % Enemies.Num();
+		if (!UpdatedThisFrame.Contains(Index))
+		{
+			UpdatedThisFrame.Add(Index);
+			NextEnemy = Index + 1;
+		}
+	}
+
+	float MaxLatency = 0.f;
+	for (int32 Index : UpdatedThisFrame)
+	{
+		MaxLatency = FMath::Max(MaxLatency, Now - LastUpdateTimes[Index]);
+		UpdateEnemy(Index, Now, Players, Rooms);
+	}
+
+	IssueMoveRequests();
+
+	SET_DWORD_STAT(STAT_EnemyAIUpdated, UpdatedThisFrame.Num());
+	SET_FLOAT_STAT(STAT_EnemyAIMaxLatency, MaxLatency * 1000.f);
+}
+
+void AEnemyAIScheduler::UpdateEnemy(int32 Index, float Now, const TArray<APawn*>& Players, const TArray<FSphere>& Rooms)
+{
+	LastUpdateTimes[Index] = Now;
+
+	AEnemy* Enemy = Enemies[Index];
+	if (!Enemy || Enemy->GetIsDead())
+	{
+		// stop the path following of enemies that just died
+		if (Enemy && (States[Index] != EEnemyAIState::Idle))
+		{
+			MoveRequests.Emplace(Index, Enemy->GetActorLocation());
+		}
+
+		States[Index] = EEnemyAIState::Idle;
+		return;
+	}
+
+	FVector Location = Enemy->GetActorLocation();
+
+	// the room the enemy is in, if any
+	const FSphere* EnemyRoom = Rooms.FindByPredicate([&](const FSphere& Room) { return Room.IsInside(Location); });
+
+	// the closest player
+	APawn* Target = nullptr;
+	float MinDistance = FMath::Square(ChaseRange);
+	for (APawn* Player : Players)
+	{
+		float Distance = FVector::DistSquared(Location, Player->GetActorLocation());
+		if (Distance < MinDistance)
+		{
+			MinDistance = Distance;
+			Target = Player;
+		}
+	}
+
+	EEnemyAIState NewState = EEnemyAIState::Idle;
+	FVector NewTarget = Location;
+
+	if (EnemyRoom && !(Target && EnemyRoom->IsInside(Target->GetActorLocation())))
+	{
+		// the room belongs to the player: leave it unless the player is in it too
+		FVector Away = (Location - EnemyRoom->Center).GetSafeNormal2D();
+		NewState = EEnemyAIState::FleeRoom;
+		NewTarget = EnemyRoom->Center + Away * (EnemyRoom->W + FleeMargin);
+	}
+	else if (Target)
+	{
+		// every other enemy flanks, alternating sides, so they don't all line up behind each other
+		if (Index % 2)
+		{
+			float Side = (Index % 4 == 1) ? 1.f : -1.f;
+			NewState = EEnemyAIState::Flank;
+			NewTarget = Target->GetActorLocation() + Target->GetActorRightVector() * FlankOffset * Side;
+		}
+		else
+		{
+			NewState = EEnemyAIState::Chase;
+			NewTarget = Target->GetActorLocation();
+		}
+	}
+
+	bool bTargetMoved = FVector::DistSquared(NewTarget, MoveTargets[Index]) > FMath::Square(RepathDistance);
+	if ((NewState != States[Index]) || ((NewState != EEnemyAIState::Idle) && bTargetMoved))
+	{
+		MoveRequests.Emplace(Index, NewTarget);
+	}
+
+	States[Index] = NewState;
+}
+
+void AEnemyAIScheduler::IssueMoveRequests()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAIMoveRequests);
+	SET_DWORD_STAT(STAT_EnemyAIMoveRequestCount, MoveRequests.Num());
+
+	for (const TPair<int32, FVector>& Request : MoveRequests)
+	{
+		AEnemy* Enemy = Enemies[Request.Key];
+		AAIController* AIController = Enemy ? Cast<AAIController>(Enemy->GetController()) : nullptr;
+		if (!AIController) { continue; }
+
+		MoveTargets[Request.Key] = Request.Value;
+
+		if (States[Request.Key] == EEnemyAIState::Idle)
+		{
+			AIController->StopMovement();
+		}
+		else
+		{
+			AIController->MoveToLocation(Request.Value, AcceptanceRadius);
+		}
+	}
+
+	MoveRequests.Reset();
+}
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "EnemyAIScheduler.generated.h"
+
+UENUM(BlueprintType)
+enum class EEnemyAIState : uint8
+{
+	Idle,
+	// runs straight to the player
+	Chase,
+	// runs to a point on the side of the player
+	Flank,
+	// runs out of a room the player is not in
+	FleeRoom,
+};
+
+// updates the decisions of all the enemies: the enemy state lives in contiguous arrays and only a fixed number of
+// enemies are updated every frame (the enemies in a room first, then round robin), the move requests are issued together
+UCLASS()
+class LAWROOM_API AEnemyAIScheduler : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	// number of enemies updated every frame
+	int32 EnemiesPerFrame = 32;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0", ClampMax = "1"))
+	// part of EnemiesPerFrame that goes to the enemies inside a room first
+	float RoomPriorityShare = 0.5f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	// enemies closer than this to the player chase or flank the player
+	float ChaseRange = 3000.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	// distance to the side of the player flanking enemies run to
+	float FlankOffset = 400.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	// distance out of the room edge fleeing enemies run to
+	float FleeMargin = 300.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	// a new move is only requested when the target moved more than this
+	float RepathDistance = 150.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	float AcceptanceRadius = 50.f;
+
+	/// enemy decision state, one entry per registered enemy in every array
+	UPROPERTY()
+	TArray<class AEnemy*> Enemies;
+	TArray<EEnemyAIState> States;
+	TArray<FVector> MoveTargets;
+	TArray<float> LastUpdateTimes;
+	// number of rooms overlapping the enemy
+	TArray<uint8> RoomCounts;
+
+	// index of every registered enemy in the arrays above
+	TMap<const class AEnemy*, int32> EnemyIndices;
+
+	// the enemies overlapped by at least one room, kept by the room enter and leave events
+	UPROPERTY()
+	TArray<class AEnemy*> RoomEnemies;
+
+	// round robin positions, in Enemies and in RoomEnemies
+	int32 NextEnemy = 0;
+	int32 NextRoomEnemy = 0;
+
+	// the move requests of the current frame
+	TArray<TPair<int32, FVector>> MoveRequests;
+
+	// enemy indices updated this frame
+	TArray<int32> UpdatedThisFrame;
+
+private:
+	// decides the new state and move target of the enemy
+	void UpdateEnemy(int32 Index, float Now, const TArray<class APawn*>& Players, const TArray<FSphere>& Rooms);
+
+	void IssueMoveRequests();
+
+public:
+	// Sets default values for this actor's properties
+	AEnemyAIScheduler();
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	void RegisterEnemy(class AEnemy* Enemy);
+	void UnregisterEnemy(class AEnemy* Enemy);
+
+	// called by the rooms when they start and stop overlapping an enemy
+	void OnEnemyEnteredRoom(class AEnemy* Enemy);
+	void OnEnemyLeftRoom(class AEnemy* Enemy);
+
+	EEnemyAIState GetEnemyState(const class AEnemy* Enemy) const;
+};
@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyCrowd.h"
+#include "LawRoom.h"
+#include "Enemy.h"
+#include "RoomAbilityComponent.h"
+#include "LawRoomMemory.h"
+#include "LawRoomFrameCapture.h"
+#include "LawRoomGameMode.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarCrowdDistanceScale(
+	TEXT("LawRoom.Crowd.DistanceScale"),
+	1.f,
+	TEXT("Scales the crowd promote and demote distances: lower keeps fewer real enemies around the players (LawRoom scalability)"));
+
+DECLARE_CYCLE_STAT(TEXT("Crowd Update"), STAT_CrowdUpdate, STATGROUP_LawRoom);
+DECLARE_CYCLE_STAT(TEXT("Crowd Instance Flush"), STAT_CrowdFlush, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Instances"), STAT_CrowdInstances, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Uploaded Instances"), STAT_CrowdUploadedInstances, STATGROUP_LawRoom);
+
+// Sets default values
+AEnemyCrowd::AEnemyCrowd()
+{
+	// the crowd is updated every UpdateInterval, not every frame
+	PrimaryActorTick.bCanEverTick = true;
+
+	Root = CreateDefaultSubobject<USceneComponent>("Root");
+	RootComponent = Root;
+
+	IdleInstances = CreateDefaultSubobject<UHierarchicalInstancedStaticMeshComponent>("IdleInstances");
+	IdleInstances->SetupAttachment(Root);
+	IdleInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	IdleInstances->SetGenerateOverlapEvents(false);
+	IdleInstances->SetCastShadow(false);
+
+	LocomotionInstances = CreateDefaultSubobject<UHierarchicalInstancedStaticMeshComponent>("LocomotionInstances");
+	LocomotionInstances->SetupAttachment(Root);
+	LocomotionInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	LocomotionInstances->SetGenerateOverlapEvents(false);
+	LocomotionInstances->SetCastShadow(false);
+}
+
+// Called when the game starts or when spawned
+void AEnemyCrowd::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorTickInterval(UpdateInterval);
+
+	ALawRoomGameMode* GameMode = GetWorld()->GetAuthGameMode<ALawRoomGameMode>();
+	if (GameMode)
+	{
+		GameMode->SetEnemyCrowd(this);
+	}
+
+	// the hand placed enemies that are already far away start as instances
+	GatherViewersAndRooms();
+
+	TArray<AEnemy*> PlacedEnemies;
+	for (TActorIterator<AEnemy> It(GetWorld()); It; ++It)
+	{
+		PlacedEnemies.Add(*It);
+	}
+
+	for (AEnemy* Enemy : PlacedEnemies)
+	{
+		if (ShouldDemote(Enemy))
+		{
+			DemoteEnemy(Enemy);
+		}
+	}
+}
+
+// Called every UpdateInterval
+void AEnemyCrowd::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	LAWROOM_FRAME_SCOPE(Crowd);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CrowdUpdate);
+
+		GatherViewersAndRooms();
+
+		// backwards because promoting swaps the last crowd enemy in
+		for (int32 Index = CrowdEnemies.Num() - 1; Index >= 0; Index--)
+		{
+			if (ShouldPromote(CrowdEnemies[Index].Transform.GetLocation()))
+			{
+				PromoteEnemy(Index);
+			}
+		}
+
+		TArray<AEnemy*> EnemiesToDemote;
+		for (TActorIterator<AEnemy> It(GetWorld()); It; ++It)
+		{
+			if (ShouldDemote(*It))
+			{
+				EnemiesToDemote.Add(*It);
+			}
+		}
+
+		for (AEnemy* Enemy : EnemiesToDemote)
+		{
+			DemoteEnemy(Enemy);
+		}
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CrowdFlush);
+		LAWROOM_LLM_SCOPE(Crowd);
+
+		int32 Uploaded = IdleBuffer.Flush(IdleInstances) + LocomotionBuffer.Flush(LocomotionInstances);
+		SET_DWORD_STAT(STAT_CrowdUploadedInstances, Uploaded);
+	}
+
+	SET_DWORD_STAT(STAT_CrowdInstances, CrowdEnemies.Num());
+}
+
+FEnemyCrowdInstanceBuffer& AEnemyCrowd::GetBuffer(ECrowdClip Clip)
+{
+	return (Clip == ECrowdClip::Locomotion) ? LocomotionBuffer : IdleBuffer;
+}
+
+void AEnemyCrowd::GatherViewersAndRooms()
+{
+	ViewLocations.Reset();
+	Rooms.Reset();
+	RoomAbilities.Reset();
+
+	TArray<APawn*> Users;
+	URoomAbilityComponent::GetRoomUsers(GetWorld(), Users);
+	for (APawn* Pawn : Users)
+	{
+		ViewLocations.Add(Pawn->GetActorLocation());
+
+		URoomAbilityComponent* RoomAbility = Pawn->FindComponentByClass<URoomAbilityComponent>();
+		if (RoomAbility)
+		{
+			RoomAbilities.Add(RoomAbility);
+
+			FSphere RoomSphere;
+			if (RoomAbility->GetRoomSphere(RoomSphere))
+			{
+				Rooms.Add(RoomSphere);
+			}
+		}
+	}
+}
+
+bool AEnemyCrowd::IsInsideRoom(const FVector& Location) const
+{
+	for (const FSphere& Room : Rooms)
+	{
+		if (Room.IsInside(Location))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+float AEnemyCrowd::GetViewDistanceSquared(const FVector& Location) const
+{
+	float MinDistance = MAX_flt;
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		MinDistance = FMath::Min(MinDistance, FVector::DistSquared(ViewLocation, Location));
+	}
+
+	return MinDistance;
+}
+
+bool AEnemyCrowd::ShouldPromote(const FVector& Location) const
+{
+	return IsInsideRoom(Location) || (GetViewDistanceSquared(Location) < FMath::Square(PromoteDistance * CVarCrowdDistanceScale.GetValueOnGameThread()));
+}
+
+bool AEnemyCrowd::ShouldDemote(AEnemy* Enemy) const
+{
+	if (!Enemy || Enemy->IsPendingKill() || Enemy->GetIsDead()) { return false; }
+
+	// the enemies of streamed arena cells come and go with their cell
+	if (Enemy->GetLevel() != GetWorld()->PersistentLevel) { return false; }
+
+	// never take away an enemy a room ability is using
+	for (URoomAbilityComponent* RoomAbility : RoomAbilities)
+	{
+		if (RoomAbility->IsEnemyInUse(Enemy))
+		{
+			return false;
+		}
+	}
+
+	FVector Location = Enemy->GetActorLocation();
+	return !IsInsideRoom(Location) && (GetViewDistanceSquared(Location) > FMath::Square(DemoteDistance * CVarCrowdDistanceScale.GetValueOnGameThread()));
+}
+
+void AEnemyCrowd::DemoteEnemy(AEnemy* Enemy)
+{
+	if (!Enemy) { return; }
+
+	LAWROOM_LLM_SCOPE(Crowd);
+
+	FCrowdEnemy CrowdEnemy;
+	CrowdEnemy.EnemyClass = Enemy->GetClass();
+	CrowdEnemy.Transform = Enemy->GetActorTransform();
+	CrowdEnemy.Clip = (Enemy->GetVelocity().SizeSquared() > FMath::Square(LocomotionSpeed)) ? ECrowdClip::Locomotion : ECrowdClip::Idle;
+
+	int32 Index = CrowdEnemies.Num();
+	CrowdEnemy.Instance = GetBuffer(CrowdEnemy.Clip).Add(CrowdEnemy.Transform, Index);
+	CrowdEnemies.Add(CrowdEnemy);
+
+	Enemy->Destroy();
+}
+
+AEnemy* AEnemyCrowd::PromoteEnemy(int32 Index)
+{
+	if (!CrowdEnemies.IsValidIndex(Index)) { return nullptr; }
+
+	FCrowdEnemy CrowdEnemy = CrowdEnemies[Index];
+	RemoveCrowdEnemy(Index);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	LAWROOM_LLM_SCOPE(Enemies);
+	return GetWorld()->SpawnActor<AEnemy>(CrowdEnemy.EnemyClass, CrowdEnemy.Transform, SpawnParams);
+}
+
+void AEnemyCrowd::PromoteEnemiesInSphere(const FSphere& Sphere)
+{
+	for (int32 Index = CrowdEnemies.Num() - 1; Index >= 0; Index--)
+	{
+		if (Sphere.IsInside(CrowdEnemies[Index].Transform.GetLocation()))
+		{
+			PromoteEnemy(Index);
+		}
+	}
+
+	IdleBuffer.Flush(IdleInstances);
+	LocomotionBuffer.Flush(LocomotionInstances);
+}
+
+void AEnemyCrowd::RemoveCrowdEnemy(int32 Index)
+{
+	// remove the instance, the instance moved in its place belongs to another crowd enemy
+	const FCrowdEnemy& Removed = CrowdEnemies[Index];
+	int32 MovedOwner = GetBuffer(Removed.Clip).RemoveAtSwap(Removed.Instance);
+	if (MovedOwner != INDEX_NONE)
+	{
+		CrowdEnemies[MovedOwner].Instance = Removed.Instance;
+	}
+
+	// then the crowd enemy, the last crowd enemy takes its index
+	int32 LastIndex = CrowdEnemies.Num() - 1;
+	if (Index != LastIndex)
+	{
+		const FCrowdEnemy& Last = CrowdEnemies[LastIndex];
+		GetBuffer(Last.Clip).SetOwner(Last.Instance, Index);
+	}
+
+	CrowdEnemies.RemoveAtSwap(Index, 1, false);
+}
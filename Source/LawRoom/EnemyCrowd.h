@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "EnemyCrowdInstanceBuffer.h"
+#include "EnemyCrowd.generated.h"
+
+// baked vertex animation clips, each one is rendered by its own instanced mesh
+UENUM()
+enum class ECrowdClip : uint8
+{
+	Idle,
+	Locomotion,
+};
+
+// an enemy that is only an instance: everything needed to spawn it back as an AEnemy
+struct FCrowdEnemy
+{
+	TSubclassOf<class AEnemy> EnemyClass;
+	FTransform Transform;
+	ECrowdClip Clip = ECrowdClip::Idle;
+	// index of the instance in the clip buffer
+	int32 Instance = INDEX_NONE;
+};
+
+// renders the enemies that are far from every player and outside every room as instances of vertex animated meshes,
+// they are promoted back to real AEnemy actors when they get close or a room reaches them
+UCLASS()
+class LAWROOM_API AEnemyCrowd : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(VisibleAnywhere)
+	class USceneComponent* Root;
+
+	UPROPERTY(VisibleAnywhere, Category = "Crowd")
+	// instances playing the baked idle clip: the mesh and its vertex animation material are set in the crowd bp
+	class UHierarchicalInstancedStaticMeshComponent* IdleInstances;
+
+	UPROPERTY(VisibleAnywhere, Category = "Crowd")
+	// instances playing the baked locomotion clip
+	class UHierarchicalInstancedStaticMeshComponent* LocomotionInstances;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	// enemies closer than this to a player are real actors
+	float PromoteDistance = 3000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	// enemies farther than this from every player become instances, bigger than PromoteDistance to avoid flickering
+	float DemoteDistance = 4000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	// enemies faster than this are demoted with the locomotion clip
+	float LocomotionSpeed = 10.f;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	// seconds between two crowd updates
+	float UpdateInterval = 0.2f;
+
+	TArray<FCrowdEnemy> CrowdEnemies;
+
+	FEnemyCrowdInstanceBuffer IdleBuffer;
+	FEnemyCrowdInstanceBuffer LocomotionBuffer;
+
+	// player locations and active rooms of this update
+	TArray<FVector> ViewLocations;
+	TArray<FSphere> Rooms;
+	TArray<class URoomAbilityComponent*> RoomAbilities;
+
+private:
+	FEnemyCrowdInstanceBuffer& GetBuffer(ECrowdClip Clip);
+
+	void GatherViewersAndRooms();
+
+	bool IsInsideRoom(const FVector& Location) const;
+
+	// squared distance to the closest player
+	float GetViewDistanceSquared(const FVector& Location) const;
+
+	bool ShouldPromote(const FVector& Location) const;
+	bool ShouldDemote(class AEnemy* Enemy) const;
+
+	// removes the crowd enemy at Index by swapping the last one in
+	void RemoveCrowdEnemy(int32 Index);
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+public:
+	// Sets default values for this actor's properties
+	AEnemyCrowd();
+
+	// Called every UpdateInterval
+	virtual void Tick(float DeltaTime) override;
+
+	// replaces the enemy with an instance
+	void DemoteEnemy(class AEnemy* Enemy);
+
+	// spawns the crowd enemy at Index back as an AEnemy
+	class AEnemy* PromoteEnemy(int32 Index);
+
+	// promotes every crowd enemy inside the sphere, used when a room is cast so the room overlaps real enemies
+	void PromoteEnemiesInSphere(const FSphere& Sphere);
+};
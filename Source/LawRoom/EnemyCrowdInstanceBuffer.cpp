@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyCrowdInstanceBuffer.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+void FEnemyCrowdInstanceBuffer::MarkDirty(int32 Index)
+{
+	FirstDirty = (FirstDirty == INDEX_NONE) ? Index : FMath::Min(FirstDirty, Index);
+	LastDirty = (LastDirty == INDEX_NONE) ? Index : FMath::Max(LastDirty, Index);
+}
+
+int32 FEnemyCrowdInstanceBuffer::Add(const FTransform& Transform, int32 Owner)
+{
+	int32 Index = Transforms.Add(Transform);
+	Owners.Add(Owner);
+	MarkDirty(Index);
+
+	return Index;
+}
+
+int32 FEnemyCrowdInstanceBuffer::RemoveAtSwap(int32 Index)
+{
+	check(Transforms.IsValidIndex(Index));
+
+	int32 LastIndex = Transforms.Num() - 1;
+	int32 MovedOwner = (Index != LastIndex) ? Owners[LastIndex] : INDEX_NONE;
+
+	Transforms.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+
+	if (MovedOwner != INDEX_NONE)
+	{
+		MarkDirty(Index);
+	}
+
+	return MovedOwner;
+}
+
+int32 FEnemyCrowdInstanceBuffer::Flush(UInstancedStaticMeshComponent* Component)
+{
+	if (!Component || !IsDirty()) { return 0; }
+
+	int32 Uploaded = 0;
+
+	// only the last instances are ever removed or added so the component never reorders its instances
+	while (ComponentInstanceCount > Transforms.Num())
+	{
+		ComponentInstanceCount--;
+		Component->RemoveInstance(ComponentInstanceCount);
+	}
+
+	int32 ExistingCount = ComponentInstanceCount;
+	while (ComponentInstanceCount < Transforms.Num())
+	{
+		Component->AddInstanceWorldSpace(Transforms[ComponentInstanceCount]);
+		ComponentInstanceCount++;
+		Uploaded++;
+	}
+
+	// the added instances are already up to date
+	LastDirty = FMath::Min(LastDirty, ExistingCount - 1);
+	if ((FirstDirty != INDEX_NONE) && (FirstDirty <= LastDirty))
+	{
+		int32 Count = LastDirty - FirstDirty + 1;
+		TArray<FTransform> DirtyTransforms(Transforms.GetData() + FirstDirty, Count);
+		Component->BatchUpdateInstancesTransforms(FirstDirty, DirtyTransforms, true, false, true);
+		Uploaded += Count;
+	}
+
+	FirstDirty = INDEX_NONE;
+	LastDirty = INDEX_NONE;
+	Component->MarkRenderStateDirty();
+
+	return Uploaded;
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UInstancedStaticMeshComponent;
+
+// CPU side copy of the instances of an instanced static mesh: instances are kept dense (removal swaps the last one in)
+// and the changes of a frame are sent to the component in one batch by Flush
+class LAWROOM_API FEnemyCrowdInstanceBuffer
+{
+private:
+	TArray<FTransform> Transforms;
+
+	// the crowd entry each instance belongs to
+	TArray<int32> Owners;
+
+	// number of instances the component has after the last flush
+	int32 ComponentInstanceCount = 0;
+
+	// range of instances changed since the last flush
+	int32 FirstDirty = INDEX_NONE;
+	int32 LastDirty = INDEX_NONE;
+
+private:
+	void MarkDirty(int32 Index);
+
+public:
+	// returns the index of the new instance
+	int32 Add(const FTransform& Transform, int32 Owner);
+
+	// removes the instance by moving the last one in its place, returns the owner of the moved instance or INDEX_NONE
+	int32 RemoveAtSwap(int32 Index);
+
+	FORCEINLINE const FTransform& GetTransform(int32 Index) const { return Transforms[Index]; }
+	FORCEINLINE int32 GetOwner(int32 Index) const { return Owners[Index]; }
+	FORCEINLINE void SetOwner(int32 Index, int32 Owner) { Owners[Index] = Owner; }
+	FORCEINLINE int32 Num() const { return Transforms.Num(); }
+	FORCEINLINE bool IsDirty() const { return (FirstDirty != INDEX_NONE) || (ComponentInstanceCount != Transforms.Num()); }
+
+	// sends the pending changes to the component, returns the number of instances that were uploaded
+	int32 Flush(UInstancedStaticMeshComponent* Component);
+};
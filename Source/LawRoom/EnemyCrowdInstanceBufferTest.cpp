@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyCrowdInstanceBuffer.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// no rendering involved, runs with -nullrhi: UE4Editor-Cmd LawRoom -nullrhi -ExecCmds="Automation RunTests LawRoom.Crowd; Quit"
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEnemyCrowdInstanceBufferTest, "LawRoom.Crowd.InstanceBuffer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FEnemyCrowdInstanceBufferTest::RunTest(const FString& Parameters)
+{
+	static const int32 InstanceCount = 10000;
+
+	// the component AEnemyCrowd uses, never registered: the instances are only kept on the CPU side
+	UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(GetTransientPackage());
+	FEnemyCrowdInstanceBuffer Buffer;
+	FRandomStream Random(InstanceCount);
+
+	// the instance of each crowd entry, kept like AEnemyCrowd keeps its crowd enemies
+	TArray<int32> EntryInstances;
+
+	for (int32 Entry = 0; Entry < InstanceCount; Entry++)
+	{
+		FVector Location(Random.FRandRange(-50000.f, 50000.f), Random.FRandRange(-50000.f, 50000.f), 0.f);
+		EntryInstances.Add(Buffer.Add(FTransform(FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f), Location), Entry));
+	}
+	int32 Uploaded = Buffer.Flush(Component);
+
+	TestEqual(TEXT("Instances uploaded by the first flush"), Uploaded, InstanceCount);
+	TestEqual(TEXT("Component instances after the adds"), Component->GetInstanceCount(), InstanceCount);
+
+	// a quarter of the crowd promoted, like rooms cast in the middle of it
+	for (int32 Step = 0; Step < InstanceCount / 4; Step++)
+	{
+		int32 Entry = Random.RandRange(0, EntryInstances.Num() - 1);
+
+		int32 Instance = EntryInstances[Entry];
+		int32 MovedOwner = Buffer.RemoveAtSwap(Instance);
+		if (MovedOwner != INDEX_NONE)
+		{
+			EntryInstances[MovedOwner] = Instance;
+		}
+
+		int32 LastEntry = EntryInstances.Num() - 1;
+		if (Entry != LastEntry)
+		{
+			Buffer.SetOwner(EntryInstances[LastEntry], Entry);
+		}
+		EntryInstances.RemoveAtSwap(Entry, 1, false);
+	}
+	Buffer.Flush(Component);
+
+	TestEqual(TEXT("Buffer instances after the removals"), Buffer.Num(), EntryInstances.Num());
+	TestEqual(TEXT("Component instances after the removals"), Component->GetInstanceCount(), Buffer.Num());
+	TestFalse(TEXT("Buffer dirty after a flush"), Buffer.IsDirty());
+	TestEqual(TEXT("Instances uploaded by a flush without changes"), Buffer.Flush(Component), 0);
+
+	// every entry still owns its instance, and the component has the transform of the buffer at every index
+	int32 WrongOwners = 0;
+	int32 WrongTransforms = 0;
+	for (int32 Entry = 0; Entry < EntryInstances.Num(); Entry++)
+	{
+		int32 Instance = EntryInstances[Entry];
+		if (Buffer.GetOwner(Instance) != Entry)
+		{
+			WrongOwners++;
+		}
+
+		FTransform ComponentTransform;
+		if (!Component->GetInstanceTransform(Instance, ComponentTransform, true) || !ComponentTransform.Equals(Buffer.GetTransform(Instance), 0.1f))
+		{
+			WrongTransforms++;
+		}
+	}
+
+	TestEqual(TEXT("Entries owning another instance"), WrongOwners, 0);
+	TestEqual(TEXT("Component instances out of sync with the buffer"), WrongTransforms, 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyMovementComponent.h"
+
+UEnemyMovementComponent::UEnemyMovementComponent()
+{
+	// asleep until the first move request
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// same speed the enemies had with the character movement
+	MaxSpeed = 600.f;
+	Acceleration = 2048.f;
+	Deceleration = 2048.f;
+
+	// the enemies walk on the navmesh, the path points height is ignored
+	SetPlaneConstraintEnabled(true);
+	SetPlaneConstraintNormal(FVector::UpVector);
+}
+
+void UEnemyMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// stopped and nothing asked to move: sleep until the next request
+	if (Velocity.IsNearlyZero() && GetPendingInputVector().IsNearlyZero())
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UEnemyMovementComponent::RequestDirectMove(const FVector& MoveVelocity, bool bForceMaxSpeed)
+{
+	SetComponentTickEnabled(true);
+	Super::RequestDirectMove(MoveVelocity, bForceMaxSpeed);
+}
+
+void UEnemyMovementComponent::AddInputVector(FVector WorldVector, bool bForce)
+{
+	SetComponentTickEnabled(true);
+	Super::AddInputVector(WorldVector, bForce);
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/FloatingPawnMovement.h"
+#include "EnemyMovementComponent.generated.h"
+
+// kinematic enemy mover: no gravity, floor checks or replication, planar moves along the AI path,
+// and it only ticks while the enemy is moving
+UCLASS()
+class LAWROOM_API UEnemyMovementComponent : public UFloatingPawnMovement
+{
+	GENERATED_BODY()
+
+public:
+	UEnemyMovementComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// wakes the mover up when the path following asks for a move
+	virtual void RequestDirectMove(const FVector& MoveVelocity, bool bForceMaxSpeed) override;
+	virtual void AddInputVector(FVector WorldVector, bool bForce = false) override;
+};
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyTargetScoring.h"
+#include "LawRoom.h"
+#include "HAL/IConsoleManager.h"
+
+void FEnemyTargetSnapshot::Reset(int32 Count)
+{
+	Num = Count;
+	int32 PaddedNum = Align(Count, 4);
+
+	X.SetNumUninitialized(PaddedNum, false);
+	Y.SetNumUninitialized(PaddedNum, false);
+	Z.SetNumUninitialized(PaddedNum, false);
+	Visible.SetNumUninitialized(PaddedNum, false);
+	Threat.SetNumUninitialized(PaddedNum, false);
+	Scores.SetNumUninitialized(PaddedNum, false);
+
+	for (int32 Index = Count; Index < PaddedNum; Index++)
+	{
+		X[Index] = Y[Index] = Z[Index] = WORLD_MAX;
+		Visible[Index] = Threat[Index] = 0.f;
+	}
+}
+
+void FEnemyTargetSnapshot::Set(int32 Index, const FVector& Location, bool bVisible, float InThreat)
+{
+	X[Index] = Location.X;
+	Y[Index] = Location.Y;
+	Z[Index] = Location.Z;
+	Visible[Index] = bVisible ? 1.f : 0.f;
+	Threat[Index] = InThreat;
+}
+
+int32 FEnemyTargetSnapshot::GetBestIndex() const
+{
+	int32 BestIndex = INDEX_NONE;
+	float BestScore = -MAX_flt;
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		if (Scores[Index] > BestScore)
+		{
+			BestScore = Scores[Index];
+			BestIndex = Index;
+		}
+	}
+
+	return BestIndex;
+}
+
+// LawRoom.BenchTargetScoring [Count]: times the target scoring against the distance only scalar loop it replaced
+static FAutoConsoleCommand BenchTargetScoringCommand(
+	TEXT("LawRoom.BenchTargetScoring"),
+	TEXT("Times the lock on target scoring (scalar distance loop, SIMD, SIMD + ParallelFor) on [Count] random enemies"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		int32 Count = (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 10000;
+		Count = FMath::Max(Count, 1);
+		const int32 Runs = 100;
+
+		FRandomStream Random(Count);
+		TArray<FVector> Locations;
+		FEnemyTargetSnapshot Snapshot;
+		Snapshot.Reset(Count);
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			FVector Location = Random.GetUnitVector() * Random.FRandRange(100.f, 5000.f);
+			Locations.Add(Location);
+			Snapshot.Set(Index, Location, Random.FRand() > 0.5f, Random.FRand() > 0.8f ? 1.f : 0.f);
+		}
+
+		FVector Origin = FVector::ZeroVector;
+		FVector Forward = FVector::ForwardVector;
+
+		// the previous lock on: closest enemy by FVector::Size
+		double Start = FPlatformTime::Seconds();
+		int32 ScalarBest = INDEX_NONE;
+		for (int32 Run = 0; Run < Runs; Run++)
+		{
+			float MinDistance = MAX_flt;
+			for (int32 Index = 0; Index < Count; Index++)
+			{
+				float Distance = (Origin - Locations[Index]).Size();
+				if (Distance < MinDistance)
+				{
+					MinDistance = Distance;
+					ScalarBest = Index;
+				}
+			}
+		}
+		double ScalarTime = (FPlatformTime::Seconds() - Start) / Runs;
+
+		Start = FPlatformTime::Seconds();
+		int32 SimdBest = INDEX_NONE;
+		for (int32 Run = 0; Run < Runs; Run++)
+		{
+			EnemyTargetScoring::Score<FLockOnScoringPolicy>(Snapshot, Origin, Forward, 5000.f, false);
+			SimdBest = Snapshot.GetBestIndex();
+		}
+		double SimdTime = (FPlatformTime::Seconds() - Start) / Runs;
+
+		Start = FPlatformTime::Seconds();
+		for (int32 Run = 0; Run < Runs; Run++)
+		{
+			EnemyTargetScoring::Score<FLockOnScoringPolicy>(Snapshot, Origin, Forward, 5000.f, true);
+			SimdBest = Snapshot.GetBestIndex();
+		}
+		double ParallelTime = (FPlatformTime::Seconds() - Start) / Runs;
+
+		UE_LOG(LogLawRoom, Display, TEXT("Target scoring on %d enemies: scalar distance %.3f us (best %d), SIMD %.3f us, SIMD parallel %.3f us (best %d)"),
+			Count, ScalarTime * 1e6, ScalarBest, SimdTime * 1e6, ParallelTime * 1e6, SimdBest);
+	})
+);
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+
+// weights of the lock on target criteria, every criterion is normalized to [0, 1] ([-1, 1] for facing)
+struct FLockOnScoringPolicy
+{
+	static constexpr float DistanceWeight = 1.f;
+	static constexpr float FacingWeight = 1.5f;
+	static constexpr float VisibilityWeight = 2.f;
+	static constexpr float ThreatWeight = 0.5f;
+};
+
+// the enemies positions and criteria in structure of arrays buffers, padded to a multiple of 4 for the vector math
+class LAWROOM_API FEnemyTargetSnapshot
+{
+public:
+	typedef TArray<float, TAlignedHeapAllocator<16>> FFloatBuffer;
+
+	FFloatBuffer X;
+	FFloatBuffer Y;
+	FFloatBuffer Z;
+	// 1 if the enemy is in sight of the player, 0 otherwise
+	FFloatBuffer Visible;
+	// 1 for enemies going after the player, 0 otherwise
+	FFloatBuffer Threat;
+	FFloatBuffer Scores;
+
+private:
+	int32 Num = 0;
+
+public:
+	// resizes the buffers for Count enemies, the padding entries are invisible and far away
+	void Reset(int32 Count);
+
+	void Set(int32 Index, const FVector& Location, bool bVisible, float InThreat);
+
+	FORCEINLINE int32 GetNum() const { return Num; }
+	FORCEINLINE int32 GetPaddedNum() const { return X.Num(); }
+
+	// index of the best score, INDEX_NONE if there is none
+	int32 GetBestIndex() const;
+};
+
+namespace EnemyTargetScoring
+{
+	// the snapshot is split in chunks of this many enemies when scored in parallel
+	static const int32 ParallelChunkSize = 256;
+
+	// scores the enemies in [Start, End), both multiples of 4
+	template<typename TPolicy>
+	void ScoreRange(FEnemyTargetSnapshot& Snapshot, int32 Start, int32 End, const FVector& Origin, const FVector& Forward, float MaxDistance)
+	{
+		const VectorRegister OriginX = VectorSetFloat1(Origin.X);
+		const VectorRegister OriginY = VectorSetFloat1(Origin.Y);
+		const VectorRegister OriginZ = VectorSetFloat1(Origin.Z);
+		const VectorRegister ForwardX = VectorSetFloat1(Forward.X);
+		const VectorRegister ForwardY = VectorSetFloat1(Forward.Y);
+		const VectorRegister ForwardZ = VectorSetFloat1(Forward.Z);
+		const VectorRegister InvMaxDistanceSquared = VectorSetFloat1(1.f / FMath::Max(FMath::Square(MaxDistance), KINDA_SMALL_NUMBER));
+		const VectorRegister MinDistanceSquared = VectorSetFloat1(KINDA_SMALL_NUMBER);
+		const VectorRegister One = VectorOne();
+
+		const VectorRegister DistanceWeight = VectorSetFloat1(TPolicy::DistanceWeight);
+		const VectorRegister FacingWeight = VectorSetFloat1(TPolicy::FacingWeight);
+		const VectorRegister VisibilityWeight = VectorSetFloat1(TPolicy::VisibilityWeight);
+		const VectorRegister ThreatWeight = VectorSetFloat1(TPolicy::ThreatWeight);
+
+		for (int32 Index = Start; Index < End; Index += 4)
+		{
+			VectorRegister DeltaX = VectorSubtract(VectorLoadAligned(&Snapshot.X[Index]), OriginX);
+			VectorRegister DeltaY = VectorSubtract(VectorLoadAligned(&Snapshot.Y[Index]), OriginY);
+			VectorRegister DeltaZ = VectorSubtract(VectorLoadAligned(&Snapshot.Z[Index]), OriginZ);
+
+			VectorRegister DistanceSquared = VectorMultiply(DeltaX, DeltaX);
+			DistanceSquared = VectorMultiplyAdd(DeltaY, DeltaY, DistanceSquared);
+			DistanceSquared = VectorMultiplyAdd(DeltaZ, DeltaZ, DistanceSquared);
+
+			// 1 at the origin, 0 at MaxDistance and beyond
+			VectorRegister Closeness = VectorSubtract(One, VectorMin(VectorMultiply(DistanceSquared, InvMaxDistanceSquared), One));
+
+			// cosine of the angle between the forward and the enemy direction
+			VectorRegister Dot = VectorMultiply(DeltaX, ForwardX);
+			Dot = VectorMultiplyAdd(DeltaY, ForwardY, Dot);
+			Dot = VectorMultiplyAdd(DeltaZ, ForwardZ, Dot);
+			VectorRegister Facing = VectorMultiply(Dot, VectorReciprocalSqrt(VectorMax(DistanceSquared, MinDistanceSquared)));
+
+			VectorRegister Score = VectorMultiply(Closeness, DistanceWeight);
+			Score = VectorMultiplyAdd(Facing, FacingWeight, Score);
+			Score = VectorMultiplyAdd(VectorLoadAligned(&Snapshot.Visible[Index]), VisibilityWeight, Score);
+			Score = VectorMultiplyAdd(VectorLoadAligned(&Snapshot.Threat[Index]), ThreatWeight, Score);
+
+			VectorStoreAligned(Score, &Snapshot.Scores[Index]);
+		}
+	}
+
+	// scores every enemy of the snapshot in one pass, in parallel chunks when bParallel is set
+	template<typename TPolicy>
+	void Score(FEnemyTargetSnapshot& Snapshot, const FVector& Origin, const FVector& Forward, float MaxDistance, bool bParallel)
+	{
+		int32 PaddedNum = Snapshot.GetPaddedNum();
+
+		if (bParallel && (PaddedNum > ParallelChunkSize))
+		{
+			int32 NumChunks = FMath::DivideAndRoundUp(PaddedNum, ParallelChunkSize);
+			ParallelFor(NumChunks, [&](int32 Chunk)
+			{
+				int32 Start = Chunk * ParallelChunkSize;
+				int32 End = FMath::Min(Start + ParallelChunkSize, PaddedNum);
+				ScoreRange<TPolicy>(Snapshot, Start, End, Origin, Forward, MaxDistance);
+			});
+		}
+		else
+		{
+			ScoreRange<TPolicy>(Snapshot, 0, PaddedNum, Origin, Forward, MaxDistance);
+		}
+	}
+}
@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EnemyWaveSpawner.h"
+#include "Enemy.h"
+#include "LawRoom.h"
+#include "LawRoomFrameCapture.h"
+#include "LawRoomMemory.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Wave Spawn"), STAT_WaveSpawn, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Wave Pending Enemies"), STAT_WavePendingEnemies, STATGROUP_LawRoom);
+
+// Sets default values
+AEnemyWaveSpawner::AEnemyWaveSpawner()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+// Called when the game starts or when spawned
+void AEnemyWaveSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the enemies are spawned by the server, the clients get them replicated
+	if (GetNetMode() == NM_Client || !ensure(EnemyClass))
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	if (!BuildSpawnPoints())
+	{
+		// the navmesh is built at runtime: the waves wait for its generation to finish, instead of polling for it
+		UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		if (NavSystem)
+		{
+			NavSystem->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &AEnemyWaveSpawner::OnNavigationGenerationFinished);
+			bIsWaitingForNavigation = true;
+		}
+	}
+
+	NextWave = 0;
+	ScheduleNextWave();
+}
+
+void AEnemyWaveSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// deferred enemies are already in the level, they would stay half built
+	for (AEnemy* Enemy : ConstructedEnemies)
+	{
+		if (Enemy)
+		{
+			Enemy->Destroy();
+		}
+	}
+	ConstructedEnemies.Reset();
+	ConstructedTransforms.Reset();
+	RemainingEnemies = 0;
+
+	UNavigationSystemV1* NavSystem = bIsWaitingForNavigation ? FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()) : nullptr;
+	if (NavSystem)
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &AEnemyWaveSpawner::OnNavigationGenerationFinished);
+	}
+	bIsWaitingForNavigation = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 AEnemyWaveSpawner::AddSpawnPoints(int32 Count)
+{
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSystem) { return 0; }
+
+	// the navmesh points are on the floor, the enemies are spawned standing on them
+	const AEnemy* EnemyDefaults = EnemyClass->GetDefaultObject<AEnemy>();
+	const UCapsuleComponent* Capsule = EnemyDefaults->GetCapsuleComponent();
+	float HalfHeight = Capsule ? Capsule->GetScaledCapsuleHalfHeight() : 0.f;
+	float MinDistanceSquared = Capsule ? FMath::Square(2.f * Capsule->GetScaledCapsuleRadius()) : 0.f;
+
+	int32 Added = 0;
+	FNavLocation NavLocation;
+	for (int32 Attempt = 0; (Attempt < Count * 2) && (Added < Count); Attempt++)
+	{
+		if (!NavSystem->GetRandomReachablePointInRadius(GetActorLocation(), SpawnRadius, NavLocation)) { continue; }
+
+		// two enemies on the same point would be pushed apart by the spawn collision handling
+		FVector Location = NavLocation.Location + FVector(0.f, 0.f, HalfHeight);
+		bool bIsTooClose = SpawnPoints.ContainsByPredicate([&](const FVector& Point) { return FVector::DistSquared(Point, Location) < MinDistanceSquared; });
+		if (!bIsTooClose)
+		{
+			SpawnPoints.Add(Location);
+			Added++;
+		}
+	}
+
+	return Added;
+}
+
+bool AEnemyWaveSpawner::BuildSpawnPoints()
+{
+	int32 Count = SpawnPointCount;
+	for (const FEnemyWave& Wave : Waves)
+	{
+		Count = FMath::Max(Count, Wave.Count);
+	}
+
+	AddSpawnPoints(Count);
+
+	UE_LOG(LogLawRoom, Log, TEXT("%s: %d spawn points on the navmesh"), *GetName(), SpawnPoints.Num());
+	return HasSpawnPoints();
+}
+
+void AEnemyWaveSpawner::GrowSpawnPoints()
+{
+	if (AddSpawnPoints(SpawnPointGrowStep) == 0)
+	{
+		bIsSpawnAreaFull = true;
+		UE_LOG(LogLawRoom, Log, TEXT("%s: no room for more than %d spawn points, bigger waves reuse them"), *GetName(), SpawnPoints.Num());
+	}
+}
+
+void AEnemyWaveSpawner::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem)
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &AEnemyWaveSpawner::OnNavigationGenerationFinished);
+	}
+	bIsWaitingForNavigation = false;
+
+	if (!BuildSpawnPoints())
+	{
+		UE_LOG(LogLawRoom, Warning, TEXT("%s: no navmesh within %.0f cm, no wave will be spawned"), *GetName(), SpawnRadius);
+	}
+}
+
+FTransform AEnemyWaveSpawner::GetNextSpawnTransform()
+{
+	// the budget grows the set before a construction runs out of points, unless the navmesh has no room left
+	if (WaveSpawnPoints >= SpawnPoints.Num())
+	{
+		WaveSpawnPoints = 0;
+	}
+
+	FVector Location = SpawnPoints[WaveSpawnPoints++];
+
+	// facing the center of the spawn area
+	FVector Direction = (GetActorLocation() - Location).GetSafeNormal2D();
+	return FTransform(Direction.IsNearlyZero() ? GetActorRotation() : Direction.Rotation(), Location);
+}
+
+// Called every frame
+void AEnemyWaveSpawner::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// the waves, scheduled or asked by LawRoom.SpawnWave, start when the navmesh points exist
+	if (!HasSpawnPoints()) { return; }
+
+	if (IsSpawning())
+	{
+		SpawnWithinBudget();
+		return;
+	}
+
+	if (Waves.IsValidIndex(NextWave) && (GetWorld()->GetTimeSeconds() >= NextWaveTime))
+	{
+		SpawnWave(Waves[NextWave].Count);
+		NextWave++;
+	}
+}
+
+void AEnemyWaveSpawner::SpawnWave(int32 Count)
+{
+	if (Count <= 0) { return; }
+
+	if (!IsSpawning())
+	{
+		WaveStats = FEnemyWaveStats();
+		WaveStats.StartTime = FPlatformTime::Seconds();
+
+		// every wave uses the points in a new order
+		for (int32 Index = SpawnPoints.Num() - 1; Index > 0; Index--)
+		{
+			SpawnPoints.Swap(Index, FMath::RandRange(0, Index));
+		}
+		WaveSpawnPoints = 0;
+	}
+
+	RemainingEnemies += Count;
+}
+
+void AEnemyWaveSpawner::ConstructEnemy()
+{
+	RemainingEnemies--;
+
+	// the native components are created and registered, the bp construction script (and its components) and begin play wait for FinishSpawning
+	FTransform Transform = GetNextSpawnTransform();
+	AEnemy* Enemy = GetWorld()->SpawnActorDeferred<AEnemy>(EnemyClass, Transform, this, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+	if (Enemy)
+	{
+		ConstructedEnemies.Add(Enemy);
+		ConstructedTransforms.Add(Transform);
+		WaveStats.Constructed++;
+	}
+}
+
+void AEnemyWaveSpawner::FinishEnemy()
+{
+	AEnemy* Enemy = ConstructedEnemies[0];
+	FTransform Transform = ConstructedTransforms[0];
+	ConstructedEnemies.RemoveAt(0, 1, false);
+	ConstructedTransforms.RemoveAt(0, 1, false);
+
+	if (Enemy && !Enemy->IsPendingKill())
+	{
+		Enemy->FinishSpawning(Transform);
+		WaveStats.Finished++;
+	}
+}
+
+void AEnemyWaveSpawner::SpawnWithinBudget()
+{
+	LAWROOM_FRAME_SCOPE(WaveSpawn);
+	SCOPE_CYCLE_COUNTER(STAT_WaveSpawn);
+	LAWROOM_LLM_SCOPE(Enemies);
+
+	float FrameMs = 0.f;
+	bool bIsFirstStep = true;
+
+	while (IsSpawning())
+	{
+		// finishing first keeps few half built enemies around, the points a construction needs come before it
+		bool bFinish = ConstructedEnemies.Num() > 0;
+		bool bGrow = !bFinish && !bIsSpawnAreaFull && (WaveSpawnPoints >= SpawnPoints.Num());
+		float& EstimateMs = bFinish ? FinishEstimateMs : (bGrow ? SpawnPointEstimateMs : ConstructEstimateMs);
+
+		if (!bIsFirstStep && (FrameMs + EstimateMs > BudgetMs)) { break; }
+
+		uint32 StartCycles = FPlatformTime::Cycles();
+		if (bFinish)
+		{
+			FinishEnemy();
+		}
+		else if (bGrow)
+		{
+			GrowSpawnPoints();
+		}
+		else
+		{
+			ConstructEnemy();
+		}
+		float StepMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+		if (bFinish)
+		{
+			WaveStats.FinishMs += StepMs;
+		}
+		else if (bGrow)
+		{
+			WaveStats.SpawnPointMs += StepMs;
+			WaveStats.SpawnPointSteps++;
+		}
+		else
+		{
+			WaveStats.ConstructMs += StepMs;
+		}
+		EstimateMs = FMath::Lerp(EstimateMs, StepMs, 0.25f);
+		FrameMs += StepMs;
+		bIsFirstStep = false;
+	}
+
+	WaveStats.Frames++;
+	WaveStats.MaxFrameMs = FMath::Max(WaveStats.MaxFrameMs, FrameMs);
+
+	SET_DWORD_STAT(STAT_WavePendingEnemies, RemainingEnemies + ConstructedEnemies.Num());
+
+	if (!IsSpawning())
+	{
+		SpawnedWaves++;
+		ReportWave();
+		ScheduleNextWave();
+	}
+}
+
+void AEnemyWaveSpawner::ScheduleNextWave()
+{
+	if (bLoopWaves && (NextWave >= Waves.Num()))
+	{
+		NextWave = 0;
+	}
+
+	if (Waves.IsValidIndex(NextWave))
+	{
+		NextWaveTime = GetWorld()->GetTimeSeconds() + Waves[NextWave].Delay;
+	}
+}
+
+void AEnemyWaveSpawner::ReportWave() const
+{
+	double Seconds = FMath::Max(FPlatformTime::Seconds() - WaveStats.StartTime, 0.001);
+	UE_LOG(LogLawRoom, Display, TEXT("%s wave %d: %d enemies in %.2f s over %d frames (%.1f enemies/s, %.2f per frame), max %.3f ms per frame for a %.2f ms budget, construction %.3f ms and FinishSpawning %.3f ms per enemy, %d spawn point steps %.3f ms"),
+		*GetName(), SpawnedWaves, WaveStats.Finished, Seconds, WaveStats.Frames, WaveStats.Finished / Seconds, (float)WaveStats.Finished / FMath::Max(WaveStats.Frames, 1),
+		WaveStats.MaxFrameMs, BudgetMs, WaveStats.ConstructMs / FMath::Max(WaveStats.Constructed, 1), WaveStats.FinishMs / FMath::Max(WaveStats.Finished, 1),
+		WaveStats.SpawnPointSteps, WaveStats.SpawnPointMs);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnWaveCommand(
+	TEXT("LawRoom.SpawnWave"),
+	TEXT("Spawns a wave of [Count] enemies from every enemy wave spawner of the level"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		int32 Count = (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 50;
+
+		int32 Spawners = 0;
+		for (TActorIterator<AEnemyWaveSpawner> It(World); It; ++It)
+		{
+			if (It->IsActorTickEnabled())
+			{
+				It->SpawnWave(Count);
+				Spawners++;
+			}
+		}
+
+		if (Spawners == 0)
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("No enemy wave spawner in %s"), *World->GetName());
+		}
+	})
+);
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "EnemyWaveSpawner.generated.h"
+
+USTRUCT()
+struct FEnemyWave
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Wave", meta = (ClampMin = "1"))
+	int32 Count = 20;
+
+	UPROPERTY(EditAnywhere, Category = "Wave")
+	// seconds between the end of the previous wave, or the begin play, and the start of this one
+	float Delay = 5.f;
+};
+
+// timings of the wave being spawned, logged when its last enemy is spawned
+struct FEnemyWaveStats
+{
+	double StartTime = 0.0;
+	int32 Frames = 0;
+	int32 Constructed = 0;
+	int32 Finished = 0;
+	int32 SpawnPointSteps = 0;
+	float SpawnPointMs = 0.f;
+	float ConstructMs = 0.f;
+	float FinishMs = 0.f;
+	float MaxFrameMs = 0.f;
+};
+
+// spawns waves of enemies on navmesh points computed at begin play (or once the navmesh is built), the construction and the FinishSpawning
+// of the enemies are spread over frames so that they take about BudgetMs of each frame
+UCLASS()
+class LAWROOM_API AEnemyWaveSpawner : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Waves")
+	// the enemy bp: its construction script sets the crosshair path
+	TSubclassOf<class AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, Category = "Waves")
+	TArray<FEnemyWave> Waves;
+
+	UPROPERTY(EditAnywhere, Category = "Waves")
+	// starts again from the first wave after the last one
+	bool bLoopWaves = false;
+
+	UPROPERTY(EditAnywhere, Category = "Waves")
+	// the spawn points are taken on the navmesh, reachable within this radius of the spawner
+	float SpawnRadius = 2500.f;
+
+	UPROPERTY(EditAnywhere, Category = "Waves", meta = (ClampMin = "1"))
+	// spawn points built ahead of the waves, more when a wave of Waves is bigger
+	int32 SpawnPointCount = 128;
+
+	UPROPERTY(EditAnywhere, Category = "Waves", meta = (ClampMin = "1"))
+	// points added by one budgeted step when a wave asked by LawRoom.SpawnWave is bigger than the set
+	int32 SpawnPointGrowStep = 8;
+
+	UPROPERTY(EditAnywhere, Category = "Waves", meta = (ClampMin = "0.1"))
+	// game thread ms spent spawning per frame, one construction or FinishSpawning is always done so the wave ends
+	float BudgetMs = 1.f;
+
+	// navmesh points with the enemy capsule half height added, shuffled at the start of every wave
+	TArray<FVector> SpawnPoints;
+	// points used by the current wave: the first ones of SpawnPoints, never used twice in a wave
+	int32 WaveSpawnPoints = 0;
+
+	// the navmesh was not built at begin play, the points are built once when its generation finishes
+	bool bIsWaitingForNavigation = false;
+
+	// the navmesh in SpawnRadius has no room for another point, a wave bigger than the set reuses its points
+	bool bIsSpawnAreaFull = false;
+
+	UPROPERTY(Transient)
+	// spawned deferred, waiting for their FinishSpawning
+	TArray<class AEnemy*> ConstructedEnemies;
+	TArray<FTransform> ConstructedTransforms;
+
+	// enemies of the current wave not constructed yet
+	int32 RemainingEnemies = 0;
+
+	int32 NextWave = 0;
+	float NextWaveTime = 0.f;
+	int32 SpawnedWaves = 0;
+
+	// running estimates of one step cost, a step is only started when it fits in the budget left
+	float SpawnPointEstimateMs = 1.f;
+	float ConstructEstimateMs = 0.5f;
+	float FinishEstimateMs = 1.f;
+
+	FEnemyWaveStats WaveStats;
+
+private:
+	// adds up to Count navmesh points at least two capsule radii away from the others, returns the number added
+	int32 AddSpawnPoints(int32 Count);
+
+	// the points of the largest wave, built ahead so that the waves never pay for them; false when the navmesh has none
+	bool BuildSpawnPoints();
+
+	// the current wave used every point: adds SpawnPointGrowStep points, as one step of the spawn budget
+	void GrowSpawnPoints();
+
+	UFUNCTION()
+	void OnNavigationGenerationFinished(class ANavigationData* NavData);
+
+	// a point the current wave has not used yet, reused ones only when the navmesh has no room left
+	FTransform GetNextSpawnTransform();
+
+	void ConstructEnemy();
+	void FinishEnemy();
+
+	// grows the spawn points, constructs and finishes enemies until BudgetMs is used
+	void SpawnWithinBudget();
+
+	// logs the throughput and the max frame cost of the wave that just ended
+	void ReportWave() const;
+
+	// sets the start time of the next wave of Waves, if any
+	void ScheduleNextWave();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Sets default values for this actor's properties
+	AEnemyWaveSpawner();
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	// adds Count enemies to the wave being spawned, or starts a new one
+	void SpawnWave(int32 Count);
+
+	FORCEINLINE bool IsSpawning() const { return (RemainingEnemies > 0) || (ConstructedEnemies.Num() > 0); }
+
+	// the waves wait for the spawn points
+	FORCEINLINE bool HasSpawnPoints() const { return SpawnPoints.Num() > 0; }
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "KatanaHitDetectionComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "LawRoom.h"
+
+// Sets default values for this component's properties
+UKatanaHitDetectionComponent::UKatanaHitDetectionComponent()
+{
+	// only ticks while a hit window is open
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// sweep after the animation has posed the katana for this frame
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+// Called every frame
+void UKatanaHitDetectionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (bIsHitWindowOpen)
+	{
+		SweepBlade();
+	}
+}
+
+void UKatanaHitDetectionComponent::SetupKatana(UStaticMeshComponent* PlayerKatana)
+{
+	if (ensure(PlayerKatana))
+	{
+		Katana = PlayerKatana;
+
+		// the sockets place the blade exactly, the mesh bounds are a fallback for a katana mesh without them
+		bHasBladeSockets = Katana->DoesSocketExist(BladeBaseSocket) && Katana->DoesSocketExist(BladeTipSocket);
+		if (!bHasBladeSockets)
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("Katana mesh has no %s and %s sockets, the blade is taken along its bounds"), *BladeBaseSocket.ToString(), *BladeTipSocket.ToString());
+		}
+	}
+}
+
+void UKatanaHitDetectionComponent::BeginHitWindow()
+{
+	if (Katana)
+	{
+		HitActors.Reset();
+		GetBladeSamples(PreviousSamples);
+
+		bIsHitWindowOpen = true;
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UKatanaHitDetectionComponent::EndHitWindow()
+{
+	if (bIsHitWindowOpen && !bIsSweeping)
+	{
+		// catch the last bit of the swing between the last tick and the end of the window
+		SweepBlade();
+	}
+
+	bIsHitWindowOpen = false;
+	HitActors.Reset();
+	PreviousSamples.Reset();
+	SetComponentTickEnabled(false);
+}
+
+void UKatanaHitDetectionComponent::GetBladeSamples(TArray<FVector>& Samples) const
+{
+	Samples.Reset(BladeSamples);
+
+	if (!Katana) { return; }
+
+	FVector BladeBase;
+	FVector BladeTip;
+	if (bHasBladeSockets)
+	{
+		BladeBase = Katana->GetSocketLocation(BladeBaseSocket);
+		BladeTip = Katana->GetSocketLocation(BladeTipSocket);
+	}
+	else
+	{
+		if (!Katana->GetStaticMesh()) { return; }
+
+		// the blade is the segment through the center of the bounds along their longest axis
+		FBox Bounds = Katana->GetStaticMesh()->GetBoundingBox();
+		FVector Extent = Bounds.GetExtent();
+		int32 Axis = (Extent.X >= Extent.Y) ? ((Extent.X >= Extent.Z) ? 0 : 2) : ((Extent.Y >= Extent.Z) ? 1 : 2);
+
+		FVector HalfBlade = FVector::ZeroVector;
+		HalfBlade[Axis] = Extent[Axis];
+		BladeBase = Katana->GetComponentTransform().TransformPosition(Bounds.GetCenter() - HalfBlade);
+		BladeTip = Katana->GetComponentTransform().TransformPosition(Bounds.GetCenter() + HalfBlade);
+	}
+
+	for (int32 Index = 0; Index < BladeSamples; Index++)
+	{
+		float Alpha = (float)Index / (float)(BladeSamples - 1);
+		Samples.Add(FMath::Lerp(BladeBase, BladeTip, Alpha));
+	}
+}
+
+void UKatanaHitDetectionComponent::SweepBlade()
+{
+	if (!Katana) { return; }
+
+	TArray<FVector> CurrentSamples;
+	GetBladeSamples(CurrentSamples);
+
+	if (PreviousSamples.Num() != CurrentSamples.Num())
+	{
+		PreviousSamples = CurrentSamples;
+		return;
+	}
+
+	TGuardValue<bool> SweepGuard(bIsSweeping, true);
+
+	FCollisionObjectQueryParams ObjectParams(ECC_Pawn);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(KatanaSweep), false, GetOwner());
+	FCollisionShape Sphere = FCollisionShape::MakeSphere(SweepRadius);
+
+	TArray<FHitResult> Hits;
+	for (int32 Index = 0; Index < CurrentSamples.Num(); Index++)
+	{
+		Hits.Reset();
+		GetWorld()->SweepMultiByObjectType(Hits, PreviousSamples[Index], CurrentSamples[Index], FQuat::Identity, ObjectParams, Sphere, QueryParams);
+
+		for (const FHitResult& Hit : Hits)
+		{
+			AActor* HitActor = Hit.GetActor();
+			if (HitActor && !HitActors.Contains(HitActor))
+			{
+				HitActors.Add(HitActor);
+				OnKatanaHit.Broadcast(HitActor, Hit);
+
+				// a listener may have closed the window (e.g. the attack is over)
+				if (!bIsHitWindowOpen) { return; }
+			}
+		}
+	}
+
+	PreviousSamples = CurrentSamples;
+}
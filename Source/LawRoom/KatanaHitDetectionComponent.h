@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "KatanaHitDetectionComponent.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnKatanaHitSignature, AActor*, HitActor, const FHitResult&, Hit);
+
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class LAWROOM_API UKatanaHitDetectionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY()
+	UStaticMeshComponent* Katana = nullptr;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// katana mesh socket at the base of the blade
+	FName BladeBaseSocket = "BladeBase";
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// katana mesh socket at the tip of the blade
+	FName BladeTipSocket = "BladeTip";
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup", meta = (ClampMin = "2"))
+	// number of points along the blade that are swept every frame
+	int32 BladeSamples = 4;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// radius of the sphere swept from each blade sample
+	float SweepRadius = 5.f;
+
+	// blade sample positions of the last frame, the sweep goes from these to the current ones
+	TArray<FVector> PreviousSamples;
+
+	// actors already hit during the current swing
+	TSet<TWeakObjectPtr<AActor>> HitActors;
+
+	// without the blade sockets the blade runs along the longest axis of the katana mesh bounds
+	bool bHasBladeSockets = false;
+
+	bool bIsHitWindowOpen = false;
+
+	// prevents the window from sweeping again when a hit listener ends it during a sweep
+	bool bIsSweeping = false;
+
+private:
+	// fills Samples with the current world positions of the blade samples
+	void GetBladeSamples(TArray<FVector>& Samples) const;
+
+	// sweeps each blade sample from its previous position to the current one
+	void SweepBlade();
+
+public:
+	// Sets default values for this component's properties
+	UKatanaHitDetectionComponent();
+
+	// Called every frame
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	void SetupKatana(UStaticMeshComponent* PlayerKatana);
+
+	// called by the katana hit window anim notify state, and around every injection dash
+	void BeginHitWindow();
+	void EndHitWindow();
+
+	FORCEINLINE bool GetIsHitWindowOpen() const { return bIsHitWindowOpen; }
+
+	UPROPERTY(BlueprintAssignable)
+	// broadcast once per actor and per swing
+	FOnKatanaHitSignature OnKatanaHit;
+};
@@ -1,7 +1,32 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "LawRoom.h"
+#include "LawRoomMemory.h"
+#include "LawRoomFrameCapture.h"
+#include "LawRoomTelemetry.h"
+#include "LawRoomScalability.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, LawRoom, "LawRoom" );
- 
\ No newline at end of file
+class FLawRoomModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		LawRoomMemory::Startup();
+		LawRoomFrameCapture::Startup();
+		LawRoomTelemetry::Startup();
+		LawRoomScalability::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		LawRoomScalability::Shutdown();
+		LawRoomTelemetry::Shutdown();
+		LawRoomFrameCapture::Shutdown();
+		LawRoomMemory::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FLawRoomModule, LawRoom, "LawRoom" );
+
+DEFINE_LOG_CATEGORY(LogLawRoom);
@@ -3,3 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogLawRoom, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("LawRoom"), STATGROUP_LawRoom, STATCAT_Advanced);
+
+// the visual and audio work of the ability (room color, crosshair, sounds, camera blends, rag doll impulses) is compiled
+// out of the LawRoomServer target, and skipped at runtime by dedicated servers of the other targets
+#define LAWROOM_WITH_COSMETICS !UE_SERVER
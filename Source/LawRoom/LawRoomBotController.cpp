@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomBotController.h"
+#include "LawRoom.h"
+#include "Enemy.h"
+#include "RoomAbilityComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bot Room Casts"), STAT_BotRoomCasts, STATGROUP_LawRoom);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bot Injection Shots"), STAT_BotInjectionShots, STATGROUP_LawRoom);
+
+void ALawRoomBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	RoomAbility = InPawn ? InPawn->FindComponentByClass<URoomAbilityComponent>() : nullptr;
+	if (!ensure(RoomAbility)) { return; }
+
+	SetState(ERoomBotState::Seek);
+
+	// bots start thinking at different times so they do not all decide in the same frame
+	GetWorldTimerManager().SetTimer(ThinkTimer, this, &ALawRoomBotController::Think, ThinkInterval, true, FMath::FRandRange(0.f, ThinkInterval));
+}
+
+void ALawRoomBotController::OnUnPossess()
+{
+	GetWorldTimerManager().ClearTimer(ThinkTimer);
+	RoomAbility = nullptr;
+
+	Super::OnUnPossess();
+}
+
+void ALawRoomBotController::SetState(ERoomBotState NewState)
+{
+	State = NewState;
+	StateStartTime = GetWorld()->GetTimeSeconds();
+}
+
+AEnemy* ALawRoomBotController::FindClosestEnemy() const
+{
+	APawn* BotPawn = GetPawn();
+	if (!BotPawn) { return nullptr; }
+
+	AEnemy* Closest = nullptr;
+	float MinDistance = MAX_flt;
+	for (TActorIterator<AEnemy> It(GetWorld()); It; ++It)
+	{
+		if (It->GetIsDead()) { continue; }
+
+		float Distance = FVector::DistSquared(BotPawn->GetActorLocation(), It->GetActorLocation());
+		if (Distance < MinDistance)
+		{
+			MinDistance = Distance;
+			Closest = *It;
+		}
+	}
+
+	return Closest;
+}
+
+void ALawRoomBotController::Think()
+{
+	if (!RoomAbility || !GetPawn()) { return; }
+
+	float StateTime = GetWorld()->GetTimeSeconds() - StateStartTime;
+
+	FSphere RoomSphere;
+	bool bHasRoom = RoomAbility->GetRoomSphere(RoomSphere);
+
+	// the room ended, look for the next enemies
+	if (!bHasRoom && (State != ERoomBotState::Seek) && (State != ERoomBotState::CastRoom))
+	{
+		ClearFocus(EAIFocusPriority::Gameplay);
+		SetState(ERoomBotState::Seek);
+	}
+
+	switch (State)
+	{
+	case ERoomBotState::Seek:
+	{
+		AEnemy* Enemy = FindClosestEnemy();
+		if (!Enemy) { return; }
+
+		if (FVector::DistSquared(GetPawn()->GetActorLocation(), Enemy->GetActorLocation()) > FMath::Square(CastDistance))
+		{
+			MoveToActor(Enemy, CastDistance * 0.5f);
+			return;
+		}
+
+		StopMovement();
+		RoomAbility->CreateRoom();
+		RoomCasts++;
+		INC_DWORD_STAT(STAT_BotRoomCasts);
+		SetState(ERoomBotState::CastRoom);
+		break;
+	}
+
+	case ERoomBotState::CastRoom:
+		if (bHasRoom && (StateTime >= RoomSpawnWait))
+		{
+			SetState(ERoomBotState::LockOn);
+		}
+		else if (!bHasRoom && (StateTime >= RoomSpawnWait))
+		{
+			// the room could not be cast, the previous one may still be disappearing
+			SetState(ERoomBotState::Seek);
+		}
+		break;
+
+	case ERoomBotState::LockOn:
+		if (!RoomAbility->GetIsFocused())
+		{
+			RoomAbility->LockOnTarget();
+		}
+
+		if (RoomAbility->GetIsFocused())
+		{
+			SetFocus(RoomAbility->GetLockedOnEnemy());
+			TargetChanges = FMath::RandRange(0, MaxTargetChanges);
+			SetState(ERoomBotState::CycleTargets);
+		}
+		break;
+
+	case ERoomBotState::CycleTargets:
+		if (TargetChanges > 0)
+		{
+			RoomAbility->ChangeTarget(1.f);
+			SetFocus(RoomAbility->GetLockedOnEnemy());
+			TargetChanges--;
+		}
+		else
+		{
+			bHasShotStarted = false;
+			RoomAbility->RequestInjectionShot();
+			InjectionShots++;
+			INC_DWORD_STAT(STAT_BotInjectionShots);
+			SetState(ERoomBotState::Shoot);
+		}
+		break;
+
+	case ERoomBotState::Shoot:
+		bHasShotStarted |= RoomAbility->GetIsInjectionShot();
+		if ((bHasShotStarted && !RoomAbility->GetIsInjectionShot()) || (StateTime >= ShotTimeout))
+		{
+			ClearFocus(EAIFocusPriority::Gameplay);
+			SetState(ERoomBotState::LockOn);
+		}
+		break;
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "LawRoomBotController.generated.h"
+
+UENUM()
+enum class ERoomBotState : uint8
+{
+	// walks to the closest enemy until it is close enough to cast a room
+	Seek,
+	// waits for the room to finish spawning
+	CastRoom,
+	LockOn,
+	// changes target a few times before shooting
+	CycleTargets,
+	// waits for the injection shot to end
+	Shoot,
+};
+
+// drives the room ability of a LawRoomCharacter like a player would: casts rooms, locks on, cycles targets and
+// injection shots continuously, used to load test the ability with many users
+UCLASS()
+class LAWROOM_API ALawRoomBotController : public AAIController
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	// seconds between two bot decisions
+	float ThinkInterval = 0.25f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	// the bot casts a room when the closest enemy is closer than this
+	float CastDistance = 800.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	// seconds the room takes to spawn before the bot locks on
+	float RoomSpawnWait = 1.5f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot", meta = (ClampMin = "0"))
+	// the bot changes target up to this many times before each shot
+	int32 MaxTargetChanges = 3;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	// seconds after which a shot that did not end is given up
+	float ShotTimeout = 10.f;
+
+	UPROPERTY()
+	class URoomAbilityComponent* RoomAbility = nullptr;
+
+	ERoomBotState State = ERoomBotState::Seek;
+	float StateStartTime = 0.f;
+
+	int32 TargetChanges = 0;
+	bool bHasShotStarted = false;
+
+	FTimerHandle ThinkTimer;
+
+	int32 RoomCasts = 0;
+	int32 InjectionShots = 0;
+
+private:
+	void Think();
+
+	void SetState(ERoomBotState NewState);
+
+	class AEnemy* FindClosestEnemy() const;
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+
+public:
+	FORCEINLINE int32 GetRoomCasts() const { return RoomCasts; }
+	FORCEINLINE int32 GetInjectionShots() const { return InjectionShots; }
+	FORCEINLINE class URoomAbilityComponent* GetRoomAbility() const { return RoomAbility; }
+};
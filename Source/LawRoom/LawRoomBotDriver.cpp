@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomBotDriver.h"
+#include "LawRoom.h"
+#include "LawRoomBotController.h"
+#include "LawRoomFrameCapture.h"
+#include "RoomAbilityComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Room Bots"), STAT_RoomBots, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Room Bots Rooms"), STAT_RoomBotsRooms, STATGROUP_LawRoom);
+
+// Sets default values
+ALawRoomBotDriver::ALawRoomBotDriver()
+{
+	// only reports every ReportInterval
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+// Called when the game starts or when spawned
+void ALawRoomBotDriver::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorTickInterval(ReportInterval);
+
+	SpawnBots();
+
+	LastWorldTickSeconds = LawRoomFrameCapture::GetTotalWorldTickSeconds();
+	LastReportFrame = GFrameCounter;
+}
+
+void ALawRoomBotDriver::SpawnBots()
+{
+	UClass* PawnClass = BotPawnClass;
+	if (!PawnClass && GetWorld()->GetAuthGameMode())
+	{
+		PawnClass = GetWorld()->GetAuthGameMode()->DefaultPawnClass;
+	}
+	if (!ensure(PawnClass)) { return; }
+
+	for (int32 Index = 0; Index < BotCount; Index++)
+	{
+		float Angle = 2.f * PI * Index / BotCount;
+		FVector Location = GetActorLocation() + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * SpawnRadius;
+		FTransform Transform(FRotator(0.f, FMath::RadiansToDegrees(Angle), 0.f), Location);
+
+		// the player pawn bp auto possesses to player 0, the bots must not take the player controller
+		APawn* Pawn = GetWorld()->SpawnActorDeferred<APawn>(PawnClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding);
+		if (!Pawn) { continue; }
+
+		Pawn->AutoPossessPlayer = EAutoReceiveInput::Disabled;
+		Pawn->AutoPossessAI = EAutoPossessAI::Disabled;
+		Pawn->FinishSpawning(Transform);
+		if (Pawn->IsPendingKill()) { continue; }
+
+		ALawRoomBotController* Bot = GetWorld()->SpawnActor<ALawRoomBotController>();
+		if (Bot)
+		{
+			Bot->Possess(Pawn);
+			Bots.Add(Bot);
+		}
+	}
+
+	UE_LOG(LogLawRoom, Display, TEXT("Spawned %d room bots"), Bots.Num());
+}
+
+// Called every ReportInterval
+void ALawRoomBotDriver::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	int32 Rooms = 0;
+	int32 RoomCasts = 0;
+	int32 InjectionShots = 0;
+	for (ALawRoomBotController* Bot : Bots)
+	{
+		if (!Bot) { continue; }
+
+		FSphere RoomSphere;
+		if (Bot->GetRoomAbility() && Bot->GetRoomAbility()->GetRoomSphere(RoomSphere))
+		{
+			Rooms++;
+		}
+		RoomCasts += Bot->GetRoomCasts();
+		InjectionShots += Bot->GetInjectionShots();
+	}
+
+	SET_DWORD_STAT(STAT_RoomBots, Bots.Num());
+	SET_DWORD_STAT(STAT_RoomBotsRooms, Rooms);
+
+	// world tick time averaged over the frames since the last report, the same with or without rendering
+	double WorldTickSeconds = LawRoomFrameCapture::GetTotalWorldTickSeconds();
+	uint64 Frames = FMath::Max<uint64>(GFrameCounter - LastReportFrame, 1);
+	float WorldTickMs = (float)((WorldTickSeconds - LastWorldTickSeconds) * 1000.0 / Frames);
+
+	float Seconds = FMath::Max(DeltaTime, KINDA_SMALL_NUMBER);
+	UE_LOG(LogLawRoom, Display, TEXT("%d room bots: %d rooms, %.1f room casts/s, %.1f injection shots/s, world tick %.2f ms per frame over %llu frames (%.3f ms per room)"),
+		Bots.Num(), Rooms, (RoomCasts - LastRoomCasts) / Seconds, (InjectionShots - LastInjectionShots) / Seconds, WorldTickMs, Frames, WorldTickMs / FMath::Max(Rooms, 1));
+
+	LastRoomCasts = RoomCasts;
+	LastInjectionShots = InjectionShots;
+	LastWorldTickSeconds = WorldTickSeconds;
+	LastReportFrame = GFrameCounter;
+}
+
+ALawRoomBotDriver* ALawRoomBotDriver::SpawnDriver(UWorld* World, int32 Count)
+{
+	if (!World || !World->GetAuthGameMode()) { return nullptr; }
+
+	AActor* PlayerStart = World->GetAuthGameMode()->FindPlayerStart(nullptr);
+	FTransform Transform = PlayerStart ? PlayerStart->GetActorTransform() : FTransform::Identity;
+
+	// the bot count is set before BeginPlay spawns the bots
+	ALawRoomBotDriver* Driver = World->SpawnActorDeferred<ALawRoomBotDriver>(ALawRoomBotDriver::StaticClass(), Transform);
+	if (Driver)
+	{
+		Driver->BotCount = FMath::Max(Count, 0);
+		Driver->FinishSpawning(Transform);
+	}
+
+	return Driver;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnBotsCommand(
+	TEXT("LawRoom.SpawnBots"),
+	TEXT("Spawns [Count] room bots at the player start, they cast rooms, lock on and injection shot continuously"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		ALawRoomBotDriver::SpawnDriver(World, (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 24);
+	})
+);
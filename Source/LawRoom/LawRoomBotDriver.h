@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LawRoomBotDriver.generated.h"
+
+// spawns room bots around itself and reports how the room ability scales with them,
+// spawned by -LawRoomBots=<Count> or LawRoom.SpawnBots [Count]
+UCLASS()
+class LAWROOM_API ALawRoomBotDriver : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Bots", meta = (ClampMin = "0"))
+	int32 BotCount = 24;
+
+	UPROPERTY(EditAnywhere, Category = "Bots")
+	// the bots are spawned on a circle of this radius around the driver
+	float SpawnRadius = 1500.f;
+
+	UPROPERTY(EditAnywhere, Category = "Bots")
+	// a LawRoomCharacter class, the game mode default pawn when not set
+	TSubclassOf<APawn> BotPawnClass;
+
+	UPROPERTY(EditAnywhere, Category = "Bots")
+	// seconds between two scaling reports
+	float ReportInterval = 5.f;
+
+	UPROPERTY()
+	TArray<class ALawRoomBotController*> Bots;
+
+	// totals at the previous report
+	int32 LastRoomCasts = 0;
+	int32 LastInjectionShots = 0;
+	double LastWorldTickSeconds = 0.0;
+	uint64 LastReportFrame = 0;
+
+private:
+	void SpawnBots();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+public:
+	// Sets default values for this actor's properties
+	ALawRoomBotDriver();
+
+	// Called every ReportInterval
+	virtual void Tick(float DeltaTime) override;
+
+	// spawns a driver with Count bots at the first player start
+	static ALawRoomBotDriver* SpawnDriver(UWorld* World, int32 Count);
+};
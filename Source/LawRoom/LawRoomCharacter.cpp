@@ -4,15 +4,21 @@
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
-#include "GameFramework/CharacterMovementComponent.h"
+#include "LawRoomMovementComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "RoomAbilityComponent.h"
+#include "KatanaHitDetectionComponent.h"
 #include "Enemy.h"
+#include "LawRoom.h"
+#include "LawRoomFrameCapture.h"
+#include "LawRoomTelemetry.h"
 #include "TimerManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerController.h"
 #include "Sound/SoundWave.h"
 
-ALawRoomCharacter::ALawRoomCharacter()
+ALawRoomCharacter::ALawRoomCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<ULawRoomMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -45,6 +51,12 @@ ALawRoomCharacter::ALawRoomCharacter()
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
 	
 	RoomAbilityComponent = CreateDefaultSubobject<URoomAbilityComponent>("RoomAbilityComponent");
+	KatanaHitDetection = CreateDefaultSubobject<UKatanaHitDetectionComponent>("KatanaHitDetection");
+}
+
+ULawRoomMovementComponent* ALawRoomCharacter::GetLawRoomMovement() const
+{
+	return Cast<ULawRoomMovementComponent>(GetCharacterMovement());
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -66,6 +78,7 @@ void ALawRoomCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerI
 	PlayerInputComponent->BindAction("LockOn", IE_Pressed, RoomAbilityComponent, &URoomAbilityComponent::LockOnTarget);
 	PlayerInputComponent->BindAxis("ChangeTarget", RoomAbilityComponent, &URoomAbilityComponent::ChangeTarget);
 	PlayerInputComponent->BindAction("InjectionShot", IE_Pressed, RoomAbilityComponent, &URoomAbilityComponent::RequestInjectionShot);
+	PlayerInputComponent->BindAction("ChainInjectionShot", IE_Pressed, RoomAbilityComponent, &URoomAbilityComponent::RequestChainInjectionShot);
 }
 
 void ALawRoomCharacter::Turn(float Rate)
@@ -103,6 +116,17 @@ void ALawRoomCharacter::BeginPlay()
 	ensure(ShotSound);
 }
 
+void ALawRoomCharacter::PlayAbilitySound(USoundWave* Sound) const
+{
+#if LAWROOM_WITH_COSMETICS
+	// the ability sounds are 2D, only the player using the ability hears them
+	if (IsLocallyControlled() && IsPlayerControlled())
+	{
+		UGameplayStatics::PlaySound2D(GetWorld(), Sound);
+	}
+#endif
+}
+
 void ALawRoomCharacter::MoveForward(float Value)
 {
 	if ((Controller != NULL) && (Value != 0.0f))
@@ -150,7 +174,7 @@ void ALawRoomCharacter::ChangeCameraAndAttack()
 				{
 					float Duration = AimingSound->GetDuration();
 
-					UGameplayStatics::PlaySound2D(GetWorld(), AimingSound);
+					PlayAbilitySound(AimingSound);
 					RoomAbilityComponent->GetLockedOnEnemy()->MoveCrosshair(Duration);
 
 					FTimerHandle TimerHandle;
@@ -167,7 +191,7 @@ void ALawRoomCharacter::ChangeCameraAndAttack()
 		FTimerHandle TimerHandle;
 		GetWorld()->GetTimerManager().SetTimer(TimerHandle, CameraTimer, Duration, false);
 
-		UGameplayStatics::PlaySound2D(GetWorld(), OmaeWaMouShindeiruSound);
+		PlayAbilitySound(OmaeWaMouShindeiruSound);
 	}
 }
 
@@ -177,10 +201,19 @@ bool ALawRoomCharacter::ChangeToNaniCamera()
 	{
 		if (RoomAbilityComponent->GetLockedOnEnemy())
 		{
-			APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
-			PlayerController->SetViewTargetWithBlend(RoomAbilityComponent->GetLockedOnEnemy(), 0.2f, EViewTargetBlendFunction::VTBlend_Cubic);
+			LAWROOM_FRAME_EVENT(NaniCamera);
+			LAWROOM_TELEMETRY(NaniCamera, this);
 
-			UGameplayStatics::PlaySound2D(GetWorld(), NaniSound);
+#if LAWROOM_WITH_COSMETICS
+			// bots have no camera
+			APlayerController* PlayerController = Cast<APlayerController>(GetController());
+			if (PlayerController)
+			{
+				PlayerController->SetViewTargetWithBlend(RoomAbilityComponent->GetLockedOnEnemy(), 0.2f, EViewTargetBlendFunction::VTBlend_Cubic);
+			}
+#endif
+
+			PlayAbilitySound(NaniSound);
 
 			return true;
 		}
@@ -191,16 +224,26 @@ bool ALawRoomCharacter::ChangeToNaniCamera()
 
 void ALawRoomCharacter::ChangeToFollowCamera()
 {
-	FollowCamera->SetRelativeTransform(OldCameraRelativeTransform);
+	LAWROOM_FRAME_EVENT(FollowCamera);
+	LAWROOM_TELEMETRY(FollowCamera, this);
 
+	// the shot waits for the blend time even when there is no camera to blend
 	float BlendTime = 0.5f;
-	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
-	PlayerController->SetViewTargetWithBlend(this, BlendTime, EViewTargetBlendFunction::VTBlend_Cubic);
+
+#if LAWROOM_WITH_COSMETICS
+	FollowCamera->SetRelativeTransform(OldCameraRelativeTransform);
+
+	APlayerController* PlayerController = Cast<APlayerController>(GetController());
+	if (PlayerController)
+	{
+		PlayerController->SetViewTargetWithBlend(this, BlendTime, EViewTargetBlendFunction::VTBlend_Cubic);
+	}
+#endif
 
 	FTimerDelegate ShootingTimer;
 	ShootingTimer.BindLambda([&]()
 	{
-			UGameplayStatics::PlaySound2D(GetWorld(), ShotSound);
+			PlayAbilitySound(ShotSound);
 			GetCharacterMovement()->SetMovementMode(MOVE_Walking);
 			RoomAbilityComponent->InjectionShot();
 	});
@@ -29,6 +29,10 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ability", meta = (AllowPrivateAccess = "true"))
 	class URoomAbilityComponent* RoomAbilityComponent;
 
+	// Katana hit detection used by the injection shot
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ability", meta = (AllowPrivateAccess = "true"))
+	class UKatanaHitDetectionComponent* KatanaHitDetection;
+
 	/// sound effects
 	UPROPERTY(EditDefaultsOnly, Category = "SoundEffects")
 	class USoundWave* OmaeWaMouShindeiruSound;
@@ -42,6 +46,10 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "SoundEffects")
 	class USoundWave* ShotSound;
 
+private:
+	// plays an ability sound effect for the local human player only, bots stay silent
+	void PlayAbilitySound(class USoundWave* Sound) const;
+
 protected:
 	virtual void BeginPlay() override;
 
@@ -68,12 +76,16 @@ protected:
 	// End of APawn interface
 
 public:
-	ALawRoomCharacter();
+	ALawRoomCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns KatanaHitDetection subobject **/
+	FORCEINLINE class UKatanaHitDetectionComponent* GetKatanaHitDetection() const { return KatanaHitDetection; }
+	/** Returns the character movement as LawRoomMovementComponent **/
+	class ULawRoomMovementComponent* GetLawRoomMovement() const;
 
 	UFUNCTION(BlueprintImplementableEvent)
     // starts injection shot animation and attack
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Enemy.h"
+#include "LawRoom.h"
+#include "LawRoomFrameCapture.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/SplineComponent.h"
+#include "Components/WidgetComponent.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ArchiveCountMem.h"
+
+namespace EnemyBenchmark
+{
+	// frames skipped after a spawn so the first ticks and registrations are not measured
+	static const int32 WarmUpFrames = 30;
+	static const int32 MeasuredFrames = 120;
+
+	enum class EPhase : uint8 { Empty, Enemy, Character };
+
+	struct FPhaseResult
+	{
+		// world tick time per frame, render independent
+		double WorldTickMs = 0.0;
+		int64 Bytes = 0;
+		int32 TickFunctions = 0;
+	};
+
+	struct FBench
+	{
+		TWeakObjectPtr<UWorld> World;
+		TSubclassOf<AEnemy> EnemyClass;
+		FVector Origin = FVector::ZeroVector;
+		int32 Count = 0;
+		EPhase Phase = EPhase::Empty;
+		int32 Frame = 0;
+		// world tick total when the warm up ended
+		double StartWorldTickSeconds = 0.0;
+		TArray<TWeakObjectPtr<AActor>> Spawned;
+		FPhaseResult Results[3];
+	};
+
+	FBench Bench;
+	FDelegateHandle TickerHandle;
+
+	// serialized size plus the exclusive resources (bodies, render data) of the actor and its components
+	void MeasureActor(AActor* Actor, FPhaseResult& Result)
+	{
+		FArchiveCountMem ActorMem(Actor);
+		Result.Bytes += ActorMem.GetMax() + Actor->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+		Result.TickFunctions += Actor->IsActorTickEnabled() ? 1 : 0;
+
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+		for (UActorComponent* Component : Components)
+		{
+			FArchiveCountMem ComponentMem(Component);
+			Result.Bytes += ComponentMem.GetMax() + Component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			Result.TickFunctions += Component->IsComponentTickEnabled() ? 1 : 0;
+		}
+	}
+
+	void DestroyActors(TArray<TWeakObjectPtr<AActor>>& Actors)
+	{
+		for (TWeakObjectPtr<AActor>& Actor : Actors)
+		{
+			if (Actor.IsValid())
+			{
+				Actor->Destroy();
+			}
+		}
+		Actors.Reset();
+	}
+
+	// a grid in front of the player so the crowd does not demote them
+	FTransform GetSpawnTransform(int32 Index)
+	{
+		int32 Side = FMath::CeilToInt(FMath::Sqrt((float)Bench.Count));
+		FVector Offset((Index / Side) * 150.f + 300.f, (Index % Side - Side / 2) * 150.f, 0.f);
+		return FTransform(Bench.Origin + Offset);
+	}
+
+	void SpawnEnemies(UWorld* World)
+	{
+		for (int32 Index = 0; Index < Bench.Count; Index++)
+		{
+			FTransform Transform = GetSpawnTransform(Index);
+			AEnemy* Enemy = World->SpawnActorDeferred<AEnemy>(Bench.EnemyClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			if (Enemy)
+			{
+				// no controller: only the pawn itself is measured
+				Enemy->AutoPossessAI = EAutoPossessAI::Disabled;
+				Enemy->FinishSpawning(Transform);
+				Bench.Spawned.Add(Enemy);
+			}
+		}
+	}
+
+	// the layout the enemies had before: a character with the same capsule, mesh and animation,
+	// and copies of the crosshair components of a live enemy so both layouts carry them
+	void SpawnCharacters(UWorld* World, const TArray<TWeakObjectPtr<AActor>>& Enemies)
+	{
+		const AEnemy* EnemyDefaults = Bench.EnemyClass->GetDefaultObject<AEnemy>();
+		USkeletalMeshComponent* EnemyMesh = EnemyDefaults->GetMesh();
+		UCapsuleComponent* EnemyCapsule = EnemyDefaults->GetCapsuleComponent();
+
+		// the crosshair path is added by the enemy bp construction script, only a spawned enemy has it
+		const TWeakObjectPtr<AActor>* TemplateEnemy = Enemies.FindByPredicate([](const TWeakObjectPtr<AActor>& Enemy) { return Enemy.IsValid(); });
+		UWidgetComponent* CrosshairTemplate = TemplateEnemy ? (*TemplateEnemy)->FindComponentByClass<UWidgetComponent>() : nullptr;
+		USplineComponent* CrosshairPathTemplate = TemplateEnemy ? (*TemplateEnemy)->FindComponentByClass<USplineComponent>() : nullptr;
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		for (int32 Index = 0; Index < Bench.Count; Index++)
+		{
+			ACharacter* Character = World->SpawnActor<ACharacter>(ACharacter::StaticClass(), GetSpawnTransform(Index), SpawnParameters);
+			if (!Character) { continue; }
+
+			Character->GetCapsuleComponent()->SetCapsuleSize(EnemyCapsule->GetUnscaledCapsuleRadius(), EnemyCapsule->GetUnscaledCapsuleHalfHeight());
+			Character->GetMesh()->SetRelativeTransform(EnemyMesh->GetRelativeTransform());
+			Character->GetMesh()->SetSkeletalMesh(EnemyMesh->SkeletalMesh);
+			Character->GetMesh()->SetAnimInstanceClass(EnemyMesh->GetAnimClass());
+			Character->GetMesh()->VisibilityBasedAnimTickOption = EnemyMesh->VisibilityBasedAnimTickOption;
+
+			if (CrosshairTemplate)
+			{
+				UWidgetComponent* Crosshair = NewObject<UWidgetComponent>(Character, NAME_None, RF_NoFlags, CrosshairTemplate);
+				Crosshair->SetupAttachment(Character->GetRootComponent());
+				Crosshair->RegisterComponent();
+			}
+
+			if (CrosshairPathTemplate)
+			{
+				USplineComponent* CrosshairPath = NewObject<USplineComponent>(Character, NAME_None, RF_NoFlags, CrosshairPathTemplate);
+				CrosshairPath->SetupAttachment(Character->GetRootComponent());
+				CrosshairPath->RegisterComponent();
+			}
+
+			Bench.Spawned.Add(Character);
+		}
+	}
+
+	void Report()
+	{
+		const FPhaseResult& Empty = Bench.Results[(int32)EPhase::Empty];
+		const FPhaseResult& Enemy = Bench.Results[(int32)EPhase::Enemy];
+		const FPhaseResult& Character = Bench.Results[(int32)EPhase::Character];
+
+		UE_LOG(LogLawRoom, Display, TEXT("Enemy bench, %d pawns, %.3f ms world tick without them"), Bench.Count, Empty.WorldTickMs);
+		UE_LOG(LogLawRoom, Display, TEXT("  AEnemy (%s): %.2f KB, %.1f tick functions, %.2f us world tick per enemy"),
+			*Bench.EnemyClass->GetName(), Enemy.Bytes / 1024.0 / Bench.Count, (float)Enemy.TickFunctions / Bench.Count,
+			(Enemy.WorldTickMs - Empty.WorldTickMs) * 1000.0 / Bench.Count);
+		UE_LOG(LogLawRoom, Display, TEXT("  ACharacter with the enemy crosshair components: %.2f KB, %.1f tick functions, %.2f us world tick per enemy"),
+			Character.Bytes / 1024.0 / Bench.Count, (float)Character.TickFunctions / Bench.Count,
+			(Character.WorldTickMs - Empty.WorldTickMs) * 1000.0 / Bench.Count);
+	}
+
+	// one phase per pawn class: warm up, average the world tick time, measure the pawns, then move on
+	bool Tick(float DeltaTime)
+	{
+		UWorld* World = Bench.World.Get();
+		if (!World)
+		{
+			Bench.Spawned.Reset();
+			TickerHandle.Reset();
+			return false;
+		}
+
+		// the core ticker runs once per frame, after the world tick
+		Bench.Frame++;
+		if (Bench.Frame < WarmUpFrames) { return true; }
+
+		if (Bench.Frame == WarmUpFrames)
+		{
+			Bench.StartWorldTickSeconds = LawRoomFrameCapture::GetTotalWorldTickSeconds();
+			return true;
+		}
+
+		if (Bench.Frame < WarmUpFrames + MeasuredFrames) { return true; }
+
+		FPhaseResult& Result = Bench.Results[(int32)Bench.Phase];
+		Result.WorldTickMs = (LawRoomFrameCapture::GetTotalWorldTickSeconds() - Bench.StartWorldTickSeconds) * 1000.0 / MeasuredFrames;
+		for (TWeakObjectPtr<AActor>& Actor : Bench.Spawned)
+		{
+			if (Actor.IsValid())
+			{
+				MeasureActor(Actor.Get(), Result);
+			}
+		}
+
+		// the measured pawns stay alive until the next phase is spawned, the characters copy components of the enemies
+		TArray<TWeakObjectPtr<AActor>> Measured = MoveTemp(Bench.Spawned);
+		Bench.Spawned.Reset();
+		Bench.Frame = 0;
+
+		bool bIsDone = false;
+		switch (Bench.Phase)
+		{
+		case EPhase::Empty:
+			Bench.Phase = EPhase::Enemy;
+			SpawnEnemies(World);
+			break;
+		case EPhase::Enemy:
+			Bench.Phase = EPhase::Character;
+			SpawnCharacters(World, Measured);
+			break;
+		default:
+			Report();
+			bIsDone = true;
+			break;
+		}
+
+		DestroyActors(Measured);
+
+		if (bIsDone)
+		{
+			TickerHandle.Reset();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Start(UWorld* World, int32 Count)
+	{
+		if (!World || TickerHandle.IsValid()) { return; }
+
+		Bench = FBench();
+		Bench.World = World;
+		Bench.Count = FMath::Max(Count, 1);
+
+		// the enemy bp has the mesh and animation the game uses
+		Bench.EnemyClass = LoadClass<AEnemy>(nullptr, TEXT("/Game/Enemy/Blueprint/BP_Enemy.BP_Enemy_C"));
+		if (!Bench.EnemyClass)
+		{
+			Bench.EnemyClass = AEnemy::StaticClass();
+		}
+
+		APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PlayerController->GetPawn())
+		{
+			Bench.Origin = PlayerController->GetPawn()->GetActorLocation();
+		}
+
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick));
+	}
+}
+
+// LawRoom.BenchEnemy [Count]: memory and world tick cost per enemy, against the ACharacter layout it replaced
+static FAutoConsoleCommandWithWorldAndArgs BenchEnemyCommand(
+	TEXT("LawRoom.BenchEnemy"),
+	TEXT("Spawns [Count] enemies then [Count] characters with the same mesh and reports their memory, tick functions and world tick time per enemy"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		EnemyBenchmark::Start(World, (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 200);
+	})
+);
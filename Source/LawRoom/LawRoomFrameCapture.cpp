@@ -0,0 +1,320 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomFrameCapture.h"
+#include "LawRoom.h"
+#include "Async/Async.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+
+static TAutoConsoleVariable<int32> CVarFrameCaptureEnable(
+	TEXT("LawRoom.FrameCapture.Enable"),
+	1,
+	TEXT("Records the timings of the last frames and dumps them around frame spikes"));
+
+static TAutoConsoleVariable<float> CVarFrameCaptureThresholdMs(
+	TEXT("LawRoom.FrameCapture.ThresholdMs"),
+	50.f,
+	TEXT("Frames longer than this (in ms) trigger a dump of the surrounding frames"));
+
+static TAutoConsoleVariable<int32> CVarFrameCaptureFrames(
+	TEXT("LawRoom.FrameCapture.Frames"),
+	120,
+	TEXT("Number of frames around a spike written in a dump, half before and half after it"));
+
+namespace LawRoomFrameCapture
+{
+	// tick group boundaries of the frame, recorded by marker tick functions
+	enum EMarker
+	{
+		Marker_PrePhysics,
+		Marker_StartPhysics,
+		Marker_EndPhysics,
+		Marker_PostUpdateWork,
+		Marker_Count
+	};
+
+	struct FFrameRecord
+	{
+		uint64 FrameNumber = 0;
+		uint32 BeginCycles = 0;
+		uint32 FrameCycles = 0;
+		uint32 MarkerCycles[Marker_Count];
+		uint32 ScopeCycles[(int32)ELawRoomFrameScope::Count];
+		uint32 Events = 0;
+		// engine thread timings of the previous frame, in cycles
+		uint32 GameThreadCycles = 0;
+		uint32 RenderThreadCycles = 0;
+
+		void Reset(uint64 InFrameNumber)
+		{
+			FrameNumber = InFrameNumber;
+			BeginCycles = FPlatformTime::Cycles();
+			FrameCycles = 0;
+			FMemory::Memzero(MarkerCycles);
+			FMemory::Memzero(ScopeCycles);
+			Events = 0;
+			GameThreadCycles = GGameThreadTime;
+			RenderThreadCycles = GRenderThreadTime;
+		}
+	};
+
+	// must hold the frames before a spike plus the frames after it recorded while waiting for the dump
+	static const int32 RingSize = 512;
+
+	FFrameRecord Ring[RingSize];
+	uint64 CurrentFrame = 0;
+	bool bIsRecording = false;
+
+	// frame at which a pending dump is written, 0 if none
+	uint64 DumpFrame = 0;
+	uint64 SpikeFrame = 0;
+
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle WorldInitHandle;
+	FDelegateHandle WorldCleanupHandle;
+	FDelegateHandle WorldPreActorTickHandle;
+	FDelegateHandle WorldPostActorTickHandle;
+
+	// world tick timing, from the actor tick start to its end of every game world
+	uint32 WorldTickStartCycles = 0;
+	uint32 FrameWorldTickCycles = 0;
+	uint32 LastFrameWorldTickCycles = 0;
+	double TotalWorldTickSeconds = 0.0;
+
+	FORCEINLINE FFrameRecord& GetRecord(uint64 Frame)
+	{
+		return Ring[Frame % RingSize];
+	}
+
+	struct FMarkerTickFunction : public FTickFunction
+	{
+		EMarker Marker = Marker_PrePhysics;
+
+		virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override
+		{
+			if (bIsRecording)
+			{
+				GetRecord(CurrentFrame).MarkerCycles[Marker] = FPlatformTime::Cycles();
+			}
+		}
+
+		virtual FString DiagnosticMessage() override
+		{
+			return TEXT("LawRoomFrameCaptureMarker");
+		}
+	};
+
+	TMap<TWeakObjectPtr<UWorld>, TArray<TUniquePtr<FMarkerTickFunction>>> WorldMarkers;
+
+	void MarkEvent(ELawRoomFrameEvent Event)
+	{
+		if (bIsRecording && IsInGameThread())
+		{
+			GetRecord(CurrentFrame).Events |= (uint32)Event;
+		}
+	}
+
+	void AddScopeCycles(ELawRoomFrameScope Scope, uint32 Cycles)
+	{
+		if (bIsRecording && IsInGameThread())
+		{
+			GetRecord(CurrentFrame).ScopeCycles[(int32)Scope] += Cycles;
+		}
+	}
+
+	float ToMs(uint32 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds(Cycles);
+	}
+
+	float GetWorldTickMs()
+	{
+		return ToMs(LastFrameWorldTickCycles);
+	}
+
+	double GetTotalWorldTickSeconds()
+	{
+		return TotalWorldTickSeconds;
+	}
+
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+	{
+		if (World && World->IsGameWorld())
+		{
+			WorldTickStartCycles = FPlatformTime::Cycles();
+		}
+	}
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+	{
+		if (!World || !World->IsGameWorld() || (WorldTickStartCycles == 0)) { return; }
+
+		uint32 Cycles = FPlatformTime::Cycles() - WorldTickStartCycles;
+		FrameWorldTickCycles += Cycles;
+		TotalWorldTickSeconds += FPlatformTime::ToSeconds(Cycles);
+		WorldTickStartCycles = 0;
+	}
+
+	// time between two markers, 0 when one of them did not tick this frame
+	float GetSegmentMs(const FFrameRecord& Record, EMarker From, EMarker To)
+	{
+		return (Record.MarkerCycles[From] && Record.MarkerCycles[To]) ? ToMs(Record.MarkerCycles[To] - Record.MarkerCycles[From]) : 0.f;
+	}
+
+	FString GetEventsString(uint32 Events)
+	{
+		static const TCHAR* EventNames[] = { TEXT("CreateRoom"), TEXT("DestroyRoom"), TEXT("NaniCamera"), TEXT("FollowCamera"), TEXT("InjectionShot"), TEXT("RagdollActivation"), TEXT("RagdollPrewarm") };
+
+		FString Result;
+		for (int32 Bit = 0; Bit < ARRAY_COUNT(EventNames); Bit++)
+		{
+			if (Events & (1 << Bit))
+			{
+				Result += Result.IsEmpty() ? EventNames[Bit] : FString(TEXT("|")) + EventNames[Bit];
+			}
+		}
+
+		return Result;
+	}
+
+	void WriteDump(uint64 FirstFrame, uint64 LastFrame)
+	{
+		// the csv is built here, the file is written on a background thread
+		FString Csv = TEXT("Frame,FrameMs,GameThreadMs,RenderThreadMs,PrePhysicsMs,PhysicsMs,PostPhysicsMs,DeathsMs,RagdollPrewarmMs,TargetScoringMs,AIMs,CrowdMs,WaveSpawnMs,Events,Spike\n");
+		for (uint64 Frame = FirstFrame; Frame <= LastFrame; Frame++)
+		{
+			const FFrameRecord& Record = GetRecord(Frame);
+			if (Record.FrameNumber != Frame) { continue; }
+
+			Csv += FString::Printf(TEXT("%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%s,%d\n"),
+				Record.FrameNumber, ToMs(Record.FrameCycles), ToMs(Record.GameThreadCycles), ToMs(Record.RenderThreadCycles),
+				GetSegmentMs(Record, Marker_PrePhysics, Marker_StartPhysics),
+				GetSegmentMs(Record, Marker_StartPhysics, Marker_EndPhysics),
+				GetSegmentMs(Record, Marker_EndPhysics, Marker_PostUpdateWork),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::Deaths]),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::RagdollPrewarm]),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::TargetScoring]),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::AI]),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::Crowd]),
+				ToMs(Record.ScopeCycles[(int32)ELawRoomFrameScope::WaveSpawn]),
+				*GetEventsString(Record.Events), (Frame == SpikeFrame) ? 1 : 0);
+		}
+
+		FString Path = FPaths::Combine(FPaths::ProfilingDir(), TEXT("LawRoom"), FString::Printf(TEXT("FrameSpike_%s_%llu.csv"), *FDateTime::Now().ToString(), SpikeFrame));
+		UE_LOG(LogLawRoom, Log, TEXT("Frame spike at frame %llu, writing %s"), SpikeFrame, *Path);
+
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Csv, Path]()
+		{
+			FFileHelper::SaveStringToFile(Csv, *Path);
+		});
+	}
+
+	void OnBeginFrame()
+	{
+		LastFrameWorldTickCycles = FrameWorldTickCycles;
+		FrameWorldTickCycles = 0;
+
+		bIsRecording = CVarFrameCaptureEnable.GetValueOnGameThread() != 0;
+		if (!bIsRecording) { return; }
+
+		CurrentFrame = GFrameCounter;
+		GetRecord(CurrentFrame).Reset(CurrentFrame);
+	}
+
+	void OnEndFrame()
+	{
+		if (!bIsRecording) { return; }
+
+		FFrameRecord& Record = GetRecord(CurrentFrame);
+		Record.FrameCycles = FPlatformTime::Cycles() - Record.BeginCycles;
+
+		int32 HalfWindow = FMath::Clamp(CVarFrameCaptureFrames.GetValueOnGameThread(), 2, RingSize - 1) / 2;
+
+		// a spike while a dump is pending is part of that dump
+		if ((DumpFrame == 0) && (ToMs(Record.FrameCycles) > CVarFrameCaptureThresholdMs.GetValueOnGameThread()))
+		{
+			SpikeFrame = CurrentFrame;
+			DumpFrame = CurrentFrame + HalfWindow;
+		}
+
+		if ((DumpFrame != 0) && (CurrentFrame >= DumpFrame))
+		{
+			uint64 FirstFrame = (SpikeFrame > (uint64)HalfWindow) ? SpikeFrame - HalfWindow : 0;
+			WriteDump(FirstFrame, CurrentFrame);
+			DumpFrame = 0;
+		}
+	}
+
+	void OnPostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS)
+	{
+		if (!World || !World->IsGameWorld() || !World->PersistentLevel) { return; }
+
+		static const ETickingGroup MarkerGroups[Marker_Count] = { TG_PrePhysics, TG_StartPhysics, TG_EndPhysics, TG_PostUpdateWork };
+
+		TArray<TUniquePtr<FMarkerTickFunction>>& Markers = WorldMarkers.FindOrAdd(World);
+		for (int32 Marker = 0; Marker < Marker_Count; Marker++)
+		{
+			TUniquePtr<FMarkerTickFunction> TickFunction = MakeUnique<FMarkerTickFunction>();
+			TickFunction->Marker = (EMarker)Marker;
+			TickFunction->TickGroup = MarkerGroups[Marker];
+			TickFunction->bCanEverTick = true;
+			TickFunction->bTickEvenWhenPaused = true;
+			// the first marker of a group ticks before the rest of the group
+			TickFunction->bHighPriority = (Marker != Marker_PostUpdateWork);
+			TickFunction->RegisterTickFunction(World->PersistentLevel);
+			Markers.Add(MoveTemp(TickFunction));
+		}
+	}
+
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	{
+		TArray<TUniquePtr<FMarkerTickFunction>>* Markers = WorldMarkers.Find(World);
+		if (Markers)
+		{
+			for (TUniquePtr<FMarkerTickFunction>& TickFunction : *Markers)
+			{
+				TickFunction->UnRegisterTickFunction();
+			}
+			WorldMarkers.Remove(World);
+		}
+	}
+
+	void Startup()
+	{
+		BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddStatic(&OnBeginFrame);
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&OnEndFrame);
+		WorldInitHandle = FWorldDelegates::OnPostWorldInitialization.AddStatic(&OnPostWorldInitialization);
+		WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&OnWorldCleanup);
+		WorldPreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddStatic(&OnWorldPreActorTick);
+		WorldPostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddStatic(&OnWorldPostActorTick);
+	}
+
+	void Shutdown()
+	{
+		FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		FWorldDelegates::OnPostWorldInitialization.Remove(WorldInitHandle);
+		FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+		FWorldDelegates::OnWorldPreActorTick.Remove(WorldPreActorTickHandle);
+		FWorldDelegates::OnWorldPostActorTick.Remove(WorldPostActorTickHandle);
+
+		for (TPair<TWeakObjectPtr<UWorld>, TArray<TUniquePtr<FMarkerTickFunction>>>& Pair : WorldMarkers)
+		{
+			for (TUniquePtr<FMarkerTickFunction>& TickFunction : Pair.Value)
+			{
+				TickFunction->UnRegisterTickFunction();
+			}
+		}
+		WorldMarkers.Empty();
+		bIsRecording = false;
+	}
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// ability events a frame can be tagged with
+enum class ELawRoomFrameEvent : uint32
+{
+	CreateRoom = 1 << 0,
+	DestroyRoom = 1 << 1,
+	NaniCamera = 1 << 2,
+	FollowCamera = 1 << 3,
+	InjectionShot = 1 << 4,
+	RagdollActivation = 1 << 5,
+	RagdollPrewarm = 1 << 6,
+};
+
+// LawRoom code timed in every frame
+enum class ELawRoomFrameScope : uint8
+{
+	Deaths,
+	RagdollPrewarm,
+	TargetScoring,
+	AI,
+	Crowd,
+	WaveSpawn,
+	Count
+};
+
+// always on ring buffer of the last frames timings: when a frame goes over LawRoom.FrameCapture.ThresholdMs
+// the frames around it are written to Saved/Profiling/LawRoom as csv
+namespace LawRoomFrameCapture
+{
+	// hooks the frame and world delegates
+	void Startup();
+	void Shutdown();
+
+	// tags the current frame with an ability event
+	void MarkEvent(ELawRoomFrameEvent Event);
+
+	// adds cycles to a LawRoom scope of the current frame
+	void AddScopeCycles(ELawRoomFrameScope Scope, uint32 Cycles);
+
+	// game thread time the game worlds spent ticking their actors, components and physics in the last frame, in ms;
+	// measured with or without rendering, unlike GGameThreadTime which stays 0 on dedicated servers and with -nullrhi
+	float GetWorldTickMs();
+
+	// the same time summed since startup, in seconds: two reads and GFrameCounter give the average over a window
+	double GetTotalWorldTickSeconds();
+
+	class FScope
+	{
+	private:
+		ELawRoomFrameScope Scope;
+		uint32 StartCycles;
+
+	public:
+		FORCEINLINE FScope(ELawRoomFrameScope InScope) : Scope(InScope), StartCycles(FPlatformTime::Cycles()) {}
+		FORCEINLINE ~FScope() { AddScopeCycles(Scope, FPlatformTime::Cycles() - StartCycles); }
+	};
+}
+
+#define LAWROOM_FRAME_SCOPE(Scope) LawRoomFrameCapture::FScope PREPROCESSOR_JOIN(LawRoomFrameScope, __LINE__)(ELawRoomFrameScope::Scope)
+#define LAWROOM_FRAME_EVENT(Event) LawRoomFrameCapture::MarkEvent(ELawRoomFrameEvent::Event)
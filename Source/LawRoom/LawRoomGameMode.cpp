@@ -2,6 +2,10 @@
 
 #include "LawRoomGameMode.h"
 #include "LawRoomCharacter.h"
+#include "EnemyAIScheduler.h"
+#include "LawRoomBotDriver.h"
+#include "Misc/CommandLine.h"
+#include "Engine/World.h"
 #include "UObject/ConstructorHelpers.h"
 
 ALawRoomGameMode::ALawRoomGameMode()
@@ -12,4 +16,29 @@ ALawRoomGameMode::ALawRoomGameMode()
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	EnemyAISchedulerClass = AEnemyAIScheduler::StaticClass();
+}
+
+void ALawRoomGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	int32 BotCount = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LawRoomBots="), BotCount))
+	{
+		ALawRoomBotDriver::SpawnDriver(GetWorld(), BotCount);
+	}
+}
+
+AEnemyAIScheduler* ALawRoomGameMode::GetEnemyAIScheduler()
+{
+	if (!EnemyAIScheduler && EnemyAISchedulerClass)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		EnemyAIScheduler = GetWorld()->SpawnActor<AEnemyAIScheduler>(EnemyAISchedulerClass, SpawnParams);
+	}
+
+	return EnemyAIScheduler;
 }
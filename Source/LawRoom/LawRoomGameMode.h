@@ -11,8 +11,38 @@ class ALawRoomGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
+private:
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	TSubclassOf<class AEnemyAIScheduler> EnemyAISchedulerClass;
+
+	UPROPERTY()
+	class AEnemyAIScheduler* EnemyAIScheduler = nullptr;
+
+	// placed in the map when the arena is split in streamed cells
+	UPROPERTY()
+	class AArenaStreamer* ArenaStreamer = nullptr;
+
+	// placed in the map when the far enemies are rendered as instances
+	UPROPERTY()
+	class AEnemyCrowd* EnemyCrowd = nullptr;
+
 public:
 	ALawRoomGameMode();
+
+	// spawns the room bots asked with -LawRoomBots=<Count>
+	virtual void StartPlay() override;
+
+	// returns the enemy AI scheduler, it is spawned the first time an enemy asks for it
+	class AEnemyAIScheduler* GetEnemyAIScheduler();
+
+	// the enemy AI scheduler if it was spawned already, never spawns it (for teardown and queries)
+	FORCEINLINE class AEnemyAIScheduler* FindEnemyAIScheduler() const { return EnemyAIScheduler; }
+
+	FORCEINLINE class AArenaStreamer* GetArenaStreamer() const { return ArenaStreamer; }
+	FORCEINLINE void SetArenaStreamer(class AArenaStreamer* Value) { ArenaStreamer = Value; }
+
+	FORCEINLINE class AEnemyCrowd* GetEnemyCrowd() const { return EnemyCrowd; }
+	FORCEINLINE void SetEnemyCrowd(class AEnemyCrowd* Value) { EnemyCrowd = Value; }
 };
 
 
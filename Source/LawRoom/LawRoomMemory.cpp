@@ -0,0 +1,329 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomMemory.h"
+#include "LawRoom.h"
+#include "RoomAbilityComponent.h"
+#include "Components/TimelineComponent.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "UObject/UObjectIterator.h"
+#include "UObject/UObjectHash.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom"), STAT_LawRoomSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Room"), STAT_LawRoomRoomLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Room Materials"), STAT_LawRoomRoomMaterialsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Enemies"), STAT_LawRoomEnemiesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Crosshair Widgets"), STAT_LawRoomCrosshairWidgetsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Ragdoll"), STAT_LawRoomRagdollLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom Crowd"), STAT_LawRoomCrowdLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("LawRoom AI"), STAT_LawRoomAILLM, STATGROUP_LLMFULL);
+#endif
+
+namespace LawRoomMemory
+{
+	FDelegateHandle SoakTickerHandle;
+
+#if !UE_BUILD_SHIPPING
+	FDelegateHandle BudgetTickerHandle;
+
+	// the classes of the budgets, loaded once instead of at every check
+	TArray<TWeakObjectPtr<UClass>> BudgetClasses;
+
+	void ResolveBudgetClasses()
+	{
+		const ULawRoomMemorySettings* Settings = GetDefault<ULawRoomMemorySettings>();
+
+		BudgetClasses.Reset(Settings->Budgets.Num());
+		for (const FLawRoomMemoryBudget& Budget : Settings->Budgets)
+		{
+			BudgetClasses.Add(Budget.Class.LoadSynchronous());
+		}
+	}
+
+	// count of the live instances of Class, and their exclusive size when bCountBytes is set (serializes every instance)
+	void GetClassUsage(UClass* Class, bool bCountBytes, int32& OutCount, int64& OutBytes)
+	{
+		TArray<UObject*> Objects;
+		GetObjectsOfClass(Class, Objects, true, RF_ClassDefaultObject | RF_ArchetypeObject);
+
+		OutCount = Objects.Num();
+		OutBytes = 0;
+		if (!bCountBytes) { return; }
+
+		for (UObject* Object : Objects)
+		{
+			FArchiveCountMem CountMem(Object);
+			OutBytes += CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+		}
+	}
+
+	int32 CheckBudgets(bool bLogAll)
+	{
+		const ULawRoomMemorySettings* Settings = GetDefault<ULawRoomMemorySettings>();
+
+		// the budgets may have been edited in the project settings
+		if (BudgetClasses.Num() != Settings->Budgets.Num())
+		{
+			ResolveBudgetClasses();
+		}
+
+		int32 OverBudget = 0;
+		for (int32 Index = 0; Index < Settings->Budgets.Num(); Index++)
+		{
+			const FLawRoomMemoryBudget& Budget = Settings->Budgets[Index];
+			UClass* Class = BudgetClasses[Index].Get();
+			if (!Class) { continue; }
+
+			// the periodic checks only pay for the size when there is a size budget, the report always shows it
+			int32 Count;
+			int64 Bytes;
+			GetClassUsage(Class, bLogAll || (Budget.MaxKilobytes > 0), Count, Bytes);
+
+			bool bOverCount = (Budget.MaxCount > 0) && (Count > Budget.MaxCount);
+			bool bOverSize = (Budget.MaxKilobytes > 0) && (Bytes > (int64)Budget.MaxKilobytes * 1024);
+
+			if (bOverCount || bOverSize)
+			{
+				OverBudget++;
+				UE_LOG(LogLawRoom, Warning, TEXT("%s over budget: %d objects (budget %d), %lld KB (budget %d KB)"),
+					*Class->GetName(), Count, Budget.MaxCount, Bytes / 1024, Budget.MaxKilobytes);
+			}
+			else if (bLogAll)
+			{
+				UE_LOG(LogLawRoom, Display, TEXT("%s: %d objects (budget %d), %lld KB (budget %d KB)"),
+					*Class->GetName(), Count, Budget.MaxCount, Bytes / 1024, Budget.MaxKilobytes);
+			}
+		}
+
+		return OverBudget;
+	}
+#endif
+
+	// room casts in a loop: fails when memory or objects keep growing after the warmup
+	struct FSoak
+	{
+		int32 Cycles = 0;
+		int32 CompletedCycles = 0;
+
+		bool bIsRoomAlive = false;
+		double PhaseStartTime = 0.0;
+
+		int64 BaselineMemory = 0;
+		int32 BaselineObjects = 0;
+	};
+
+	FSoak Soak;
+
+	UWorld* GetGameWorld()
+	{
+		if (GEngine)
+		{
+			for (const FWorldContext& Context : GEngine->GetWorldContexts())
+			{
+				if (Context.World() && Context.World()->IsGameWorld())
+				{
+					return Context.World();
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	int32 GetLiveObjectCount()
+	{
+		return GUObjectArray.GetObjectArrayNumMinusAvailable();
+	}
+
+	// memory of the LawRoom LLM tags, unlike the used physical memory it does not move with the engine caches and allocator pools
+	bool GetTrackedMemory(int64& OutBytes)
+	{
+		OutBytes = 0;
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (!FLowLevelMemTracker::IsEnabled()) { return false; }
+
+		for (int32 Tag = (int32)ELawRoomLLMTag::Room; Tag <= (int32)ELawRoomLLMTag::AI; Tag++)
+		{
+			OutBytes += FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, (ELLMTag)Tag);
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// a full purge, so the objects pending destruction are not counted
+	void CollectAllGarbage()
+	{
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+	}
+
+	void FinishSoak()
+	{
+		CollectAllGarbage();
+
+		int64 Memory;
+		bool bHasMemory = GetTrackedMemory(Memory);
+		int64 MemoryGrowth = bHasMemory ? Memory - Soak.BaselineMemory : 0;
+		int32 ObjectGrowth = GetLiveObjectCount() - Soak.BaselineObjects;
+		const ULawRoomMemorySettings* Settings = GetDefault<ULawRoomMemorySettings>();
+
+#if !UE_BUILD_SHIPPING
+		CheckBudgets(true);
+#endif
+
+		if (!bHasMemory)
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("LawRoom soak ran without -LLM, only the object growth is checked"));
+		}
+
+		bool bHasFailed = (MemoryGrowth > (int64)Settings->SoakMaxGrowthMegabytes * 1024 * 1024) || (ObjectGrowth > Settings->SoakMaxObjectGrowth);
+		if (bHasFailed)
+		{
+			UE_LOG(LogLawRoom, Error, TEXT("LawRoom soak failed after %d room casts: LawRoom memory grew %lld KB, %d more objects"), Soak.CompletedCycles, MemoryGrowth / 1024, ObjectGrowth);
+		}
+		else
+		{
+			UE_LOG(LogLawRoom, Display, TEXT("LawRoom soak passed after %d room casts: LawRoom memory grew %lld KB, %d more objects"), Soak.CompletedCycles, MemoryGrowth / 1024, ObjectGrowth);
+		}
+
+		// a failure is seen by the CI through the exit code
+		if (IsRunningCommandlet() || FParse::Param(FCommandLine::Get(), TEXT("unattended")))
+		{
+			FPlatformMisc::RequestExitWithStatus(false, bHasFailed ? 1 : 0);
+		}
+	}
+
+	bool TickSoak(float DeltaTime)
+	{
+		UWorld* World = GetGameWorld();
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		URoomAbilityComponent* RoomAbility = Pawn ? Pawn->FindComponentByClass<URoomAbilityComponent>() : nullptr;
+
+		// wait for the player
+		if (!RoomAbility) { return true; }
+
+		const ULawRoomMemorySettings* Settings = GetDefault<ULawRoomMemorySettings>();
+		double Now = World->GetRealTimeSeconds();
+		if (Now - Soak.PhaseStartTime < Settings->SoakRoomLifeSpan) { return true; }
+
+		Soak.PhaseStartTime = Now;
+
+		if (!Soak.bIsRoomAlive)
+		{
+			// the room spawn timeline is normally started by an anim notify, headless runs may not tick animations
+			RoomAbility->CreateRoom();
+			RoomAbility->GetSpawnRoomTimeline()->PlayFromStart();
+			Soak.bIsRoomAlive = true;
+			return true;
+		}
+
+		RoomAbility->DestroyRoom();
+		Soak.bIsRoomAlive = false;
+		Soak.CompletedCycles++;
+
+		if (Soak.CompletedCycles == Settings->SoakWarmupCycles)
+		{
+			CollectAllGarbage();
+			GetTrackedMemory(Soak.BaselineMemory);
+			Soak.BaselineObjects = GetLiveObjectCount();
+		}
+
+		if (Soak.CompletedCycles >= Soak.Cycles + Settings->SoakWarmupCycles)
+		{
+			FinishSoak();
+			SoakTickerHandle.Reset();
+			return false;
+		}
+
+		return true;
+	}
+
+	void StartSoak(int32 Cycles)
+	{
+		if (SoakTickerHandle.IsValid()) { return; }
+
+		Soak = FSoak();
+		Soak.Cycles = FMath::Max(Cycles, 1);
+		SoakTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickSoak));
+
+		UE_LOG(LogLawRoom, Display, TEXT("LawRoom soak started for %d room casts"), Soak.Cycles);
+	}
+
+	void Startup()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		FLowLevelMemTracker& Tracker = FLowLevelMemTracker::Get();
+		FName SummaryStat = GET_STATFNAME(STAT_LawRoomSummaryLLM);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::Room, TEXT("LawRoomRoom"), GET_STATFNAME(STAT_LawRoomRoomLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::RoomMaterials, TEXT("LawRoomRoomMaterials"), GET_STATFNAME(STAT_LawRoomRoomMaterialsLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::Enemies, TEXT("LawRoomEnemies"), GET_STATFNAME(STAT_LawRoomEnemiesLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::CrosshairWidgets, TEXT("LawRoomCrosshairWidgets"), GET_STATFNAME(STAT_LawRoomCrosshairWidgetsLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::Ragdoll, TEXT("LawRoomRagdoll"), GET_STATFNAME(STAT_LawRoomRagdollLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::Crowd, TEXT("LawRoomCrowd"), GET_STATFNAME(STAT_LawRoomCrowdLLM), SummaryStat);
+		Tracker.RegisterProjectTag((int32)ELawRoomLLMTag::AI, TEXT("LawRoomAI"), GET_STATFNAME(STAT_LawRoomAILLM), SummaryStat);
+#endif
+
+#if !UE_BUILD_SHIPPING
+		float Interval = GetDefault<ULawRoomMemorySettings>()->BudgetCheckInterval;
+		if (Interval > 0.f)
+		{
+			ResolveBudgetClasses();
+			BudgetTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+			{
+				CheckBudgets(false);
+				return true;
+			}), Interval);
+		}
+#endif
+
+		int32 SoakCycles = 0;
+		if (FParse::Value(FCommandLine::Get(), TEXT("LawRoomSoak="), SoakCycles))
+		{
+			StartSoak(SoakCycles);
+		}
+	}
+
+	void Shutdown()
+	{
+#if !UE_BUILD_SHIPPING
+		if (BudgetTickerHandle.IsValid())
+		{
+			FTicker::GetCoreTicker().RemoveTicker(BudgetTickerHandle);
+			BudgetTickerHandle.Reset();
+		}
+		BudgetClasses.Empty();
+#endif
+
+		if (SoakTickerHandle.IsValid())
+		{
+			FTicker::GetCoreTicker().RemoveTicker(SoakTickerHandle);
+			SoakTickerHandle.Reset();
+		}
+	}
+
+#if !UE_BUILD_SHIPPING
+	static FAutoConsoleCommand MemReportCommand(
+		TEXT("LawRoom.MemReport"),
+		TEXT("Logs the object count and size of every class with a LawRoom memory budget"),
+		FConsoleCommandDelegate::CreateLambda([]() { CheckBudgets(true); })
+	);
+#endif
+
+	static FAutoConsoleCommand SoakCommand(
+		TEXT("LawRoom.Soak"),
+		TEXT("Casts and destroys rooms [Cycles] times after a warmup and reports the memory and object growth"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			StartSoak((Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 100);
+		})
+	);
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "LawRoomMemory.generated.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+// Low Level Memory tracker tags of the LawRoom allocations (-LLM to enable)
+enum class ELawRoomLLMTag : LLM_TAG_TYPE
+{
+	Room = (LLM_TAG_TYPE)ELLMTag::ProjectTagStart,
+	RoomMaterials,
+	Enemies,
+	CrosshairWidgets,
+	Ragdoll,
+	Crowd,
+	AI,
+};
+
+#define LAWROOM_LLM_SCOPE(Tag) LLM_SCOPE((ELLMTag)ELawRoomLLMTag::Tag)
+
+#else
+
+#define LAWROOM_LLM_SCOPE(Tag)
+
+#endif
+
+USTRUCT()
+struct FLawRoomMemoryBudget
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, config)
+	TSoftClassPtr<UObject> Class;
+
+	UPROPERTY(EditAnywhere, config)
+	// 0 for no count budget
+	int32 MaxCount = 0;
+
+	UPROPERTY(EditAnywhere, config)
+	// 0 for no size budget
+	int32 MaxKilobytes = 0;
+};
+
+// per class memory budgets and soak settings, set in DefaultGame.ini
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "LawRoom Memory"))
+class LAWROOM_API ULawRoomMemorySettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, config, Category = "Budgets")
+	TArray<FLawRoomMemoryBudget> Budgets;
+
+	UPROPERTY(EditAnywhere, config, Category = "Budgets")
+	// seconds between two budget checks, 0 to disable them; never checked in shipping builds
+	float BudgetCheckInterval = 0.f;
+
+	UPROPERTY(EditAnywhere, config, Category = "Soak")
+	// room casts before the soak takes its memory baseline
+	int32 SoakWarmupCycles = 5;
+
+	UPROPERTY(EditAnywhere, config, Category = "Soak")
+	// seconds a soak room lives before it is destroyed
+	float SoakRoomLifeSpan = 1.f;
+
+	UPROPERTY(EditAnywhere, config, Category = "Soak")
+	// the soak fails when the LawRoom LLM tags grew more than this after the warmup, only checked with -LLM
+	int32 SoakMaxGrowthMegabytes = 32;
+
+	UPROPERTY(EditAnywhere, config, Category = "Soak")
+	// the soak fails when more objects than this are alive after the last full garbage collection than after the warmup
+	int32 SoakMaxObjectGrowth = 64;
+};
+
+namespace LawRoomMemory
+{
+	// registers the LLM tags and starts the budget checks, and the soak when -LawRoomSoak=<Cycles> is on the command line
+	void Startup();
+	void Shutdown();
+
+#if !UE_BUILD_SHIPPING
+	// logs the count and size of every budgeted class, warns for the ones over budget; returns the number over budget
+	int32 CheckBudgets(bool bLogAll);
+#endif
+}
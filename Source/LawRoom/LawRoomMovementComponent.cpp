@@ -0,0 +1,286 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomMovementComponent.h"
+#include "Curves/CurveFloat.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "GameFramework/Character.h"
+
+ULawRoomMovementComponent::ULawRoomMovementComponent()
+{
+	// for the dash move rpc
+	bReplicates = true;
+}
+
+FNetworkPredictionData_Client* ULawRoomMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		ULawRoomMovementComponent* MutableThis = const_cast<ULawRoomMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_LawRoom(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void ULawRoomMovementComponent::StartInjectionDash(const FVector& TargetLocation)
+{
+	if (!UpdatedComponent || !CharacterOwner) { return; }
+
+	// the dash of a remote player comes from its moves, not from the server copy of the ability
+	if (IsServerOfRemotePlayer()) { return; }
+
+	DashTarget = TargetLocation;
+	bWantsInjectionDash = true;
+}
+
+bool ULawRoomMovementComponent::IsServerOfRemotePlayer() const
+{
+	return CharacterOwner && (CharacterOwner->Role == ROLE_Authority) && (CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy);
+}
+
+void ULawRoomMovementComponent::CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove)
+{
+	const FSavedMove_LawRoom* DashMove = static_cast<const FSavedMove_LawRoom*>(NewMove);
+	if (!DashMove->bSavedWantsInjectionDash)
+	{
+		Super::CallServerMove(NewMove, OldMove);
+		return;
+	}
+
+	// the unacknowledged important move and the move held back for combining go first, on their own
+	if (OldMove)
+	{
+		CharacterOwner->ServerMoveOld(OldMove->TimeStamp, OldMove->Acceleration, OldMove->GetCompressedFlags());
+	}
+
+	FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	if (ClientData->PendingMove.IsValid())
+	{
+		FSavedMovePtr PendingMove = ClientData->PendingMove;
+		ClientData->PendingMove = nullptr;
+		Super::CallServerMove(PendingMove.Get(), nullptr);
+	}
+
+	UPrimitiveComponent* ClientMovementBase = NewMove->EndBase.Get();
+	FVector SendLocation = MovementBaseUtility::UseRelativeLocation(ClientMovementBase) ? NewMove->SavedRelativeLocation : NewMove->SavedLocation;
+	uint32 ClientYawPitch = PackYawAndPitchTo32(NewMove->SavedControlRotation.Yaw, NewMove->SavedControlRotation.Pitch);
+	uint8 ClientRoll = FRotator::CompressAxisToByte(NewMove->SavedControlRotation.Roll);
+
+	ServerMoveDash(NewMove->TimeStamp, NewMove->Acceleration, SendLocation, NewMove->GetCompressedFlags(), ClientRoll, ClientYawPitch,
+		ClientMovementBase, NewMove->EndBoneName, NewMove->EndPackedMovementMode, DashMove->SavedDashTarget);
+}
+
+bool ULawRoomMovementComponent::ServerMoveDash_Validate(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode, FVector_NetQuantize10 Target)
+{
+	return !Target.ContainsNaN() && ServerMove_Validate(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void ULawRoomMovementComponent::ServerMoveDash_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode, FVector_NetQuantize10 Target)
+{
+	// the target must be in dash reach of where the server has the character, otherwise the move runs without its dash and the client is corrected
+	if (UpdatedComponent && (FVector::DistSquared(UpdatedComponent->GetComponentLocation(), Target) <= FMath::Square(MaxDashDistance)))
+	{
+		DashTarget = Target;
+		DashTargetTimeStamp = TimeStamp;
+	}
+
+	ServerMove_Implementation(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+
+void ULawRoomMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsInjectionDash = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+}
+
+void ULawRoomMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	if (bWantsInjectionDash)
+	{
+		bWantsInjectionDash = false;
+
+		// a dash flag without its target (e.g. resent by ServerMoveOld) never starts a dash on the server
+		if (IsServerOfRemotePlayer() && (GetPredictionData_Server_Character()->CurrentClientTimeStamp != DashTargetTimeStamp)) { return; }
+
+		BeginInjectionDash();
+	}
+}
+
+void ULawRoomMovementComponent::BeginInjectionDash()
+{
+	if (!UpdatedComponent) { return; }
+
+	DashStart = UpdatedComponent->GetComponentLocation();
+	DashEnd = DashTarget;
+
+	// the number of steps only depends on the dash itself, never on the frame rate
+	float Distance = (DashEnd - DashStart).Size();
+	int32 TimeSteps = FMath::CeilToInt(DashDuration * DashSubstepRate);
+	int32 DistanceSteps = FMath::CeilToInt(Distance / MaxDashStepDistance);
+	DashSteps = FMath::Clamp(FMath::Max(TimeSteps, DistanceSteps), 1, MaxDashSteps);
+	DashStepTime = DashDuration / DashSteps;
+	DashStep = 0;
+	DashAccumulator = 0.f;
+
+	// face the target during the dash
+	FRotator DashRotation = UKismetMathLibrary::FindLookAtRotation(DashStart, DashEnd);
+	UpdatedComponent->SetWorldRotation(FRotator(0.f, DashRotation.Yaw, 0.f));
+
+	SetMovementMode(MOVE_Custom, CMOVE_InjectionDash);
+}
+
+bool ULawRoomMovementComponent::IsInjectionDashing() const
+{
+	return (MovementMode == MOVE_Custom) && (CustomMovementMode == CMOVE_InjectionDash);
+}
+
+FVector ULawRoomMovementComponent::GetDashLocation(float Alpha) const
+{
+	float Progress = DashCurve ? DashCurve->GetFloatValue(Alpha) : Alpha;
+	return FMath::Lerp(DashStart, DashEnd, Progress);
+}
+
+void ULawRoomMovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	Super::PhysCustom(DeltaTime, Iterations);
+
+	if (CustomMovementMode == CMOVE_InjectionDash)
+	{
+		// simulated proxies never know the dash, they follow the replicated location
+		if (CharacterOwner && (CharacterOwner->Role == ROLE_SimulatedProxy)) { return; }
+
+		PhysInjectionDash(DeltaTime);
+	}
+}
+
+void ULawRoomMovementComponent::PhysInjectionDash(float DeltaTime)
+{
+	if (!UpdatedComponent || DeltaTime < MIN_TICK_TIME) { return; }
+
+	FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	bool bIsBlocked = false;
+	FHitResult BlockingHit;
+
+	DashAccumulator += DeltaTime;
+	while ((DashAccumulator >= DashStepTime) && (DashStep < DashSteps) && !bIsBlocked)
+	{
+		DashAccumulator -= DashStepTime;
+		DashStep++;
+
+		// the last step always targets the exact end of the dash
+		FVector DesiredLocation = (DashStep == DashSteps) ? DashEnd : GetDashLocation((float)DashStep / DashSteps);
+
+		// a steep DashCurve asks for more than MaxDashStepDistance in one step: it is swept in several moves, never cut short
+		FVector Remaining = DesiredLocation - UpdatedComponent->GetComponentLocation();
+		int32 Moves = FMath::Max(FMath::CeilToInt(Remaining.Size() / MaxDashStepDistance), 1);
+		for (int32 Move = 0; (Move < Moves) && !bIsBlocked; Move++)
+		{
+			FVector Delta = (DesiredLocation - UpdatedComponent->GetComponentLocation()).GetClampedToMaxSize(MaxDashStepDistance);
+
+			SafeMoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), true, BlockingHit);
+
+			if (BlockingHit.IsValidBlockingHit())
+			{
+				// the dash ends on whatever it hits first (normally the target)
+				bIsBlocked = true;
+			}
+		}
+	}
+
+	Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / DeltaTime;
+
+	if (bIsBlocked || (DashStep >= DashSteps))
+	{
+		EndInjectionDash(BlockingHit);
+	}
+}
+
+void ULawRoomMovementComponent::EndInjectionDash(const FHitResult& BlockingHit)
+{
+	Velocity = FVector::ZeroVector;
+	DashStep = DashSteps;
+	DashAccumulator = 0.f;
+
+	// falling lands back to walking on the next floor check
+	SetMovementMode(MOVE_Falling);
+
+	OnInjectionDashEnded.Broadcast(BlockingHit);
+}
+
+void FSavedMove_LawRoom::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsInjectionDash = false;
+	SavedDashTarget = FVector::ZeroVector;
+	SavedDashStart = FVector::ZeroVector;
+	SavedDashEnd = FVector::ZeroVector;
+	SavedDashSteps = 0;
+	SavedDashStep = 0;
+	SavedDashStepTime = 0.f;
+	SavedDashAccumulator = 0.f;
+}
+
+uint8 FSavedMove_LawRoom::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+	if (bSavedWantsInjectionDash)
+	{
+		Flags |= FLAG_Custom_0;
+	}
+
+	return Flags;
+}
+
+bool FSavedMove_LawRoom::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_LawRoom* Other = static_cast<const FSavedMove_LawRoom*>(NewMove.Get());
+
+	// the move starting a dash and the moves during it are sent one by one
+	if (bSavedWantsInjectionDash || Other->bSavedWantsInjectionDash || (SavedDashStep < SavedDashSteps)) { return false; }
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_LawRoom::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	// the dash state the move starts from
+	ULawRoomMovementComponent* Movement = Cast<ULawRoomMovementComponent>(Character->GetCharacterMovement());
+	if (!Movement) { return; }
+
+	bSavedWantsInjectionDash = Movement->bWantsInjectionDash;
+	SavedDashTarget = Movement->DashTarget;
+	SavedDashStart = Movement->DashStart;
+	SavedDashEnd = Movement->DashEnd;
+	SavedDashSteps = Movement->DashSteps;
+	SavedDashStep = Movement->DashStep;
+	SavedDashStepTime = Movement->DashStepTime;
+	SavedDashAccumulator = Movement->DashAccumulator;
+}
+
+void FSavedMove_LawRoom::PrepMoveFor(ACharacter* Character)
+{
+	Super::PrepMoveFor(Character);
+
+	// back to the dash state of the move before it is replayed
+	ULawRoomMovementComponent* Movement = Cast<ULawRoomMovementComponent>(Character->GetCharacterMovement());
+	if (!Movement) { return; }
+
+	Movement->DashTarget = SavedDashTarget;
+	Movement->DashStart = SavedDashStart;
+	Movement->DashEnd = SavedDashEnd;
+	Movement->DashSteps = SavedDashSteps;
+	Movement->DashStep = SavedDashStep;
+	Movement->DashStepTime = SavedDashStepTime;
+	Movement->DashAccumulator = SavedDashAccumulator;
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_LawRoom::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_LawRoom());
+}
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "LawRoomMovementComponent.generated.h"
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnInjectionDashEndedSignature, const FHitResult& /* BlockingHit */);
+
+UENUM(BlueprintType)
+enum ELawRoomMovementMode
+{
+	CMOVE_None UMETA(Hidden),
+	// injection shot dash toward the locked on enemy
+	CMOVE_InjectionDash UMETA(DisplayName = "Injection Dash"),
+};
+
+UCLASS()
+class LAWROOM_API ULawRoomMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash")
+	// maps the normalized dash time to the normalized travelled distance, linear if not set
+	UCurveFloat* DashCurve = nullptr;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash", meta = (ClampMin = "0.01"))
+	// dash duration in seconds
+	float DashDuration = 0.2f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash", meta = (ClampMin = "1"))
+	// number of fixed substeps per second of dash
+	float DashSubstepRate = 120.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash", meta = (ClampMin = "1"))
+	// maximum distance swept in a single move, long dashes get more substeps and steep curve steps several moves
+	float MaxDashStepDistance = 100.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash", meta = (ClampMin = "1"))
+	// upper bound of substeps in one dash
+	int32 MaxDashSteps = 256;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Injection Dash", meta = (ClampMin = "1"))
+	// the server refuses the dash of a remote player toward a target farther than this (in cm)
+	float MaxDashDistance = 4000.f;
+
+	// the dash is fully described by these values so it plays the same on every machine and frame rate,
+	// they are saved with each client move so a corrected client replays the dash exactly
+	FVector DashStart;
+	FVector DashEnd;
+	int32 DashSteps = 0;
+	int32 DashStep = 0;
+	float DashStepTime = 0.f;
+	float DashAccumulator = 0.f;
+
+	// the dash starts at the next movement update, from the move flags on the server
+	bool bWantsInjectionDash = false;
+	FVector DashTarget;
+
+	// server: client time stamp of the move DashTarget was sent with, only that move may start the dash
+	float DashTargetTimeStamp = -1.f;
+
+	friend class FSavedMove_LawRoom;
+
+private:
+	// dash location at a normalized time
+	FVector GetDashLocation(float Alpha) const;
+
+	// sets up the dash from the current location to DashTarget
+	void BeginInjectionDash();
+
+	// the remote player is simulated here from its moves
+	bool IsServerOfRemotePlayer() const;
+
+	UFUNCTION(Server, Unreliable, WithValidation)
+	// ServerMove of the move that starts the dash, with the dash target so the two can never arrive apart
+	void ServerMoveDash(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode, FVector_NetQuantize10 Target);
+
+	void PhysInjectionDash(float DeltaTime);
+
+	// BlockingHit is not a valid blocking hit when the dash reached its end
+	void EndInjectionDash(const FHitResult& BlockingHit);
+
+protected:
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove) override;
+
+public:
+	ULawRoomMovementComponent();
+
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	// dashes the character from its location to TargetLocation, stops at the first blocking hit;
+	// called on the owning client (or the server for AI), the server replays it from the client moves
+	void StartInjectionDash(const FVector& TargetLocation);
+
+	bool IsInjectionDashing() const;
+
+	// broadcast when the dash reaches its end or hits something, with the blocking hit that stopped it
+	FOnInjectionDashEndedSignature OnInjectionDashEnded;
+};
+
+// client move with the dash state it started from, replayed after a server correction
+class FSavedMove_LawRoom : public FSavedMove_Character
+{
+	typedef FSavedMove_Character Super;
+
+	friend class ULawRoomMovementComponent;
+
+private:
+	bool bSavedWantsInjectionDash = false;
+	FVector SavedDashTarget;
+	FVector SavedDashStart;
+	FVector SavedDashEnd;
+	int32 SavedDashSteps = 0;
+	int32 SavedDashStep = 0;
+	float SavedDashStepTime = 0.f;
+	float SavedDashAccumulator = 0.f;
+
+public:
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* Character) override;
+};
+
+class FNetworkPredictionData_Client_LawRoom : public FNetworkPredictionData_Client_Character
+{
+	typedef FNetworkPredictionData_Client_Character Super;
+
+public:
+	FNetworkPredictionData_Client_LawRoom(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomScalability.h"
+#include "LawRoom.h"
+#include "LawRoomFrameCapture.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/ConfigCacheIni.h"
+#include "SynthBenchmark.h"
+#if LAWROOM_WITH_COSMETICS
+#include "AudioDevice.h"
+#include "Engine/Engine.h"
+#endif
+
+static TAutoConsoleVariable<int32> CVarQuality(
+	TEXT("LawRoom.Quality"),
+	3,
+	TEXT("LawRoom scalability level: 0 low, 1 medium, 2 high, 3 epic, applies the [LawRoomQuality@<Level>] cvars of Scalability.ini"));
+
+static TAutoConsoleVariable<int32> CVarDynamicQuality(
+	TEXT("LawRoom.Quality.Dynamic"),
+	1,
+	TEXT("Lowers the LawRoom quality while the world tick misses LawRoom.Quality.GameThreadBudgetMs, and raises it back up to LawRoom.Quality"));
+
+static TAutoConsoleVariable<float> CVarGameThreadBudgetMs(
+	TEXT("LawRoom.Quality.GameThreadBudgetMs"),
+	16.6f,
+	TEXT("World tick time per frame (in ms) the dynamic LawRoom quality aims for"));
+
+static TAutoConsoleVariable<int32> CVarAudioMaxVoices(
+	TEXT("LawRoom.Audio.MaxVoices"),
+	0,
+	TEXT("Sounds played at once, 0 for the count the audio device started with (LawRoom scalability)"));
+
+#if LAWROOM_WITH_COSMETICS
+// the audio device only takes its voice count from code
+static FAutoConsoleVariableSink AudioMaxVoicesSink(FConsoleCommandDelegate::CreateLambda([]()
+{
+	FAudioDevice* AudioDevice = GEngine ? GEngine->GetMainAudioDevice() : nullptr;
+	if (!AudioDevice) { return; }
+
+	// the voice count can be lowered but not raised above the one the device started with
+	static int32 StartVoices = AudioDevice->GetMaxChannels();
+	int32 Voices = CVarAudioMaxVoices.GetValueOnGameThread();
+	Voices = (Voices > 0) ? FMath::Min(Voices, StartVoices) : StartVoices;
+
+	if (Voices != AudioDevice->GetMaxChannels())
+	{
+		AudioDevice->SetMaxChannels(Voices);
+	}
+}));
+#endif
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("LawRoom Quality"), STAT_LawRoomQuality, STATGROUP_LawRoom);
+
+namespace LawRoomScalability
+{
+	static const int32 NumLevels = 4;
+
+	// CPU perf index (100 is the engine reference machine) needed for medium, high and epic, in the engine PerfIndexThresholds format
+	static const TCHAR* DefaultThresholds = TEXT("CPU 20 50 70");
+
+	// the world tick average has to stay over budget this long for the level to be lowered,
+	// and under RaiseBudgetShare of the budget this long for it to be raised back
+	static const double LowerDelay = 2.0;
+	static const double RaiseDelay = 10.0;
+	static const float RaiseBudgetShare = 0.7f;
+
+	int32 RequestedLevel = NumLevels - 1;
+	int32 AppliedLevel = INDEX_NONE;
+
+	float AverageWorldTickMs = 0.f;
+	// platform time the average went over budget, or under the raise share, 0 when it did not
+	double OverBudgetTime = 0.0;
+	double UnderBudgetTime = 0.0;
+
+	FDelegateHandle TickerHandle;
+
+	const TCHAR* GetLevelName(int32 Level)
+	{
+		static const TCHAR* LevelNames[] = { TEXT("Low"), TEXT("Medium"), TEXT("High"), TEXT("Epic") };
+		static_assert(ARRAY_COUNT(LevelNames) == NumLevels, "Every quality level needs a name");
+
+		return LevelNames[FMath::Clamp(Level, 0, NumLevels - 1)];
+	}
+
+	void ApplyLevel(int32 Level)
+	{
+		Level = FMath::Clamp(Level, 0, NumLevels - 1);
+		if (Level == AppliedLevel) { return; }
+
+		// same priority as the engine scalability groups: project and console settings of a cvar win over it
+		ApplyCVarSettingsGroupFromIni(TEXT("LawRoomQuality"), Level, *GScalabilityIni, ECVF_SetByScalability);
+		AppliedLevel = Level;
+
+		OverBudgetTime = 0.0;
+		UnderBudgetTime = 0.0;
+
+		UE_LOG(LogLawRoom, Log, TEXT("LawRoom quality %s"), GetLevelName(Level));
+	}
+
+	void OnQualityChanged(IConsoleVariable* Variable)
+	{
+		RequestedLevel = FMath::Clamp(Variable->GetInt(), 0, NumLevels - 1);
+		ApplyLevel(RequestedLevel);
+
+		// remembered for the next runs so the benchmark is not run again
+		if (!GIsEditor)
+		{
+			GConfig->SetInt(TEXT("LawRoom.Scalability"), TEXT("QualityLevel"), RequestedLevel, GGameUserSettingsIni);
+		}
+	}
+
+	// like the dynamic resolution: steps the level down while the world tick is over budget, and back up when it has room again
+	bool TickDynamicQuality(float DeltaTime)
+	{
+		SET_DWORD_STAT(STAT_LawRoomQuality, AppliedLevel);
+
+		if (!CVarDynamicQuality.GetValueOnGameThread()) { return true; }
+
+		// loading hitches are not the game thread missing its budget
+		if (DeltaTime > 0.5f) { return true; }
+
+		// the world tick, not GGameThreadTime: the engine only measures that one when it renders
+		AverageWorldTickMs = FMath::Lerp(AverageWorldTickMs, LawRoomFrameCapture::GetWorldTickMs(), 0.1f);
+
+		float BudgetMs = CVarGameThreadBudgetMs.GetValueOnGameThread();
+		double Now = FPlatformTime::Seconds();
+
+		if (AverageWorldTickMs > BudgetMs)
+		{
+			UnderBudgetTime = 0.0;
+			if (OverBudgetTime == 0.0)
+			{
+				OverBudgetTime = Now;
+			}
+			else if ((AppliedLevel > 0) && (Now - OverBudgetTime > LowerDelay))
+			{
+				UE_LOG(LogLawRoom, Warning, TEXT("World tick at %.2f ms for a %.2f ms budget, lowering the LawRoom quality to %s"),
+					AverageWorldTickMs, BudgetMs, GetLevelName(AppliedLevel - 1));
+				ApplyLevel(AppliedLevel - 1);
+			}
+		}
+		else if (AverageWorldTickMs < BudgetMs * RaiseBudgetShare)
+		{
+			OverBudgetTime = 0.0;
+			if (UnderBudgetTime == 0.0)
+			{
+				UnderBudgetTime = Now;
+			}
+			else if ((AppliedLevel < RequestedLevel) && (Now - UnderBudgetTime > RaiseDelay))
+			{
+				UE_LOG(LogLawRoom, Log, TEXT("World tick at %.2f ms for a %.2f ms budget, raising the LawRoom quality to %s"),
+					AverageWorldTickMs, BudgetMs, GetLevelName(AppliedLevel + 1));
+				ApplyLevel(AppliedLevel + 1);
+			}
+		}
+		else
+		{
+			OverBudgetTime = 0.0;
+			UnderBudgetTime = 0.0;
+		}
+
+		return true;
+	}
+
+	int32 BenchmarkQualityLevel()
+	{
+		double StartTime = FPlatformTime::Seconds();
+
+		// CPU only, the LawRoom knobs are game thread and physics costs
+		FSynthBenchmarkResults Results;
+		ISynthBenchmark::Get().Run(Results, false, 1.f);
+		float CPUIndex = Results.ComputeCPUPerfIndex();
+
+		FString Thresholds = DefaultThresholds;
+		GConfig->GetString(TEXT("ScalabilitySettings"), TEXT("PerfIndexThresholds_LawRoomQuality"), Thresholds, GScalabilityIni);
+
+		TArray<FString> Tokens;
+		Thresholds.ParseIntoArrayWS(Tokens);
+
+		// the first token is the processor the thresholds are for
+		int32 Level = 0;
+		for (int32 Index = 1; (Index < Tokens.Num()) && (Index < NumLevels); Index++)
+		{
+			if (CPUIndex >= FCString::Atof(*Tokens[Index]))
+			{
+				Level = Index;
+			}
+		}
+
+		UE_LOG(LogLawRoom, Display, TEXT("CPU benchmark: perf index %.1f in %.0f ms, LawRoom quality %s"),
+			CPUIndex, (FPlatformTime::Seconds() - StartTime) * 1000.0, GetLevelName(Level));
+		return Level;
+	}
+
+	void Startup()
+	{
+		// a dedicated server has none of the cosmetics the levels scale, and nobody to benchmark for
+		if (IsRunningCommandlet() || IsRunningDedicatedServer()) { return; }
+
+		CVarQuality.AsVariable()->SetOnChangedCallback(FConsoleVariableDelegate::CreateStatic(&OnQualityChanged));
+
+		// the editor keeps the default level, a benchmark would measure the editor load
+		if (!GIsEditor)
+		{
+			int32 Level = RequestedLevel;
+			if (!GConfig->GetInt(TEXT("LawRoom.Scalability"), TEXT("QualityLevel"), Level, GGameUserSettingsIni) || FParse::Param(FCommandLine::Get(), TEXT("LawRoomBenchmark")))
+			{
+				Level = BenchmarkQualityLevel();
+			}
+
+			CVarQuality.AsVariable()->Set(Level, ECVF_SetByGameSetting);
+
+			TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickDynamicQuality));
+		}
+
+		// applies the level even when Set left the value unchanged
+		OnQualityChanged(CVarQuality.AsVariable());
+	}
+
+	void Shutdown()
+	{
+		if (TickerHandle.IsValid())
+		{
+			FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+			TickerHandle.Reset();
+		}
+
+		CVarQuality.AsVariable()->SetOnChangedCallback(FConsoleVariableDelegate());
+	}
+}
+
+static FAutoConsoleCommand QualityBenchmarkCommand(
+	TEXT("LawRoom.Quality.Benchmark"),
+	TEXT("Runs the CPU benchmark again and sets LawRoom.Quality to the level it picks"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		CVarQuality.AsVariable()->Set(LawRoomScalability::BenchmarkQualityLevel(), ECVF_SetByConsole);
+	})
+);
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// LawRoom scalability group: LawRoom.Quality (0 low, 1 medium, 2 high, 3 epic) applies the cvars of the
+// [LawRoomQuality@<Level>] section of Scalability.ini, like the engine sg. groups
+namespace LawRoomScalability
+{
+	// picks the quality with a CPU benchmark on the first run (or with -LawRoomBenchmark), then the saved one,
+	// and starts lowering it while the world tick misses its budget; does nothing on dedicated servers
+	void Startup();
+	void Shutdown();
+
+	// runs the CPU part of the synth benchmark and returns the quality level it is fast enough for
+	int32 BenchmarkQualityLevel();
+}
@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomTelemetry.h"
+#include "LawRoom.h"
+#include "Containers/Ticker.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Templates/Atomic.h"
+
+static TAutoConsoleVariable<float> CVarTelemetryFlushInterval(
+	TEXT("LawRoom.Telemetry.FlushInterval"),
+	2.f,
+	TEXT("Seconds between two flushes of the telemetry file"));
+
+namespace LawRoomTelemetry
+{
+	// single producer single consumer ring: only the producer moves Head, only the consumer moves Tail
+	template<typename T, uint32 Capacity>
+	class TSpscRing
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	private:
+		T Items[Capacity];
+		TAtomic<uint32> Head{ 0 };
+		TAtomic<uint32> Tail{ 0 };
+
+	public:
+		bool Push(const T& Item)
+		{
+			uint32 CurrentHead = Head.Load(EMemoryOrder::Relaxed);
+			if (CurrentHead - Tail.Load() == Capacity) { return false; }
+
+			Items[CurrentHead & (Capacity - 1)] = Item;
+			// publishes the item to the consumer
+			Head.Store(CurrentHead + 1);
+			return true;
+		}
+
+		bool Pop(T& OutItem)
+		{
+			uint32 CurrentTail = Tail.Load(EMemoryOrder::Relaxed);
+			if (CurrentTail == Head.Load()) { return false; }
+
+			OutItem = Items[CurrentTail & (Capacity - 1)];
+			// gives the slot back to the producer
+			Tail.Store(CurrentTail + 1);
+			return true;
+		}
+
+		uint32 Num() const
+		{
+			return Head.Load() - Tail.Load();
+		}
+	};
+
+	// about a minute of heavy bot load
+	static const uint32 RingCapacity = 8192;
+
+	TSpscRing<FLawRoomTelemetryRecord, RingCapacity> Ring;
+
+	// the writer is woken up when the ring gets this full, otherwise it drains on its own every WakeUpMs
+	static const uint32 WakeUpThreshold = RingCapacity / 4;
+	static const uint32 WakeUpMs = 100;
+
+	double StartSeconds = 0.0;
+	bool bIsEnabled = false;
+	uint32 DroppedRecords = 0;
+
+	class FWriter : public FRunnable
+	{
+	private:
+		IFileHandle* File = nullptr;
+		FEvent* WakeUpEvent = nullptr;
+		FThreadSafeBool bStopping;
+		TArray<uint8> Buffer;
+		double LastFlushTime = 0.0;
+
+	public:
+		FWriter(IFileHandle* InFile)
+			: File(InFile)
+		{
+			WakeUpEvent = FPlatformProcess::GetSynchEventFromPool();
+		}
+
+		virtual ~FWriter()
+		{
+			FPlatformProcess::ReturnSynchEventToPool(WakeUpEvent);
+			delete File;
+		}
+
+		void WakeUp()
+		{
+			WakeUpEvent->Trigger();
+		}
+
+		// writes the records in the ring, flushes the file every LawRoom.Telemetry.FlushInterval
+		void Drain(bool bForceFlush)
+		{
+			Buffer.Reset();
+			FMemoryWriter Ar(Buffer);
+
+			FLawRoomTelemetryRecord Record;
+			while (Ring.Pop(Record))
+			{
+				Ar << Record;
+			}
+
+			if (Buffer.Num() != 0)
+			{
+				File->Write(Buffer.GetData(), Buffer.Num());
+			}
+
+			double Now = FPlatformTime::Seconds();
+			if (bForceFlush || (Now - LastFlushTime > CVarTelemetryFlushInterval.GetValueOnAnyThread()))
+			{
+				File->Flush();
+				LastFlushTime = Now;
+			}
+		}
+
+		virtual uint32 Run() override
+		{
+			while (!bStopping)
+			{
+				WakeUpEvent->Wait(WakeUpMs);
+				Drain(false);
+			}
+
+			Drain(true);
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping = true;
+			WakeUpEvent->Trigger();
+		}
+	};
+
+	FWriter* Writer = nullptr;
+	FRunnableThread* WriterThread = nullptr;
+	// drains on the game thread when the platform has no threads
+	FDelegateHandle DrainTickerHandle;
+
+	const TCHAR* GetEventName(ELawRoomTelemetryEvent Event)
+	{
+		static const TCHAR* EventNames[] = { TEXT("RoomCast"), TEXT("RoomDestroyed"), TEXT("LockOn"), TEXT("LockOff"), TEXT("TargetSwitch"),
+			TEXT("ShotRequested"), TEXT("ShotStarted"), TEXT("ShotFinished"), TEXT("Kill"), TEXT("NaniCamera"), TEXT("FollowCamera") };
+		static_assert(ARRAY_COUNT(EventNames) == (int32)ELawRoomTelemetryEvent::Count, "Every telemetry event needs a name");
+
+		return (Event < ELawRoomTelemetryEvent::Count) ? EventNames[(int32)Event] : TEXT("Unknown");
+	}
+
+	void Record(ELawRoomTelemetryEvent Event, const UObject* User, float Value)
+	{
+		// the game thread is the only producer
+		if (!bIsEnabled || !IsInGameThread()) { return; }
+
+		FLawRoomTelemetryRecord NewRecord;
+		NewRecord.Event = Event;
+		NewRecord.User = User ? User->GetUniqueID() : 0;
+		NewRecord.Time = (uint64)((FPlatformTime::Seconds() - StartSeconds) * 1000000.0);
+		NewRecord.Value = Value;
+
+		if (!Ring.Push(NewRecord))
+		{
+			DroppedRecords++;
+			return;
+		}
+
+		if (WriterThread && (Ring.Num() >= WakeUpThreshold))
+		{
+			Writer->WakeUp();
+		}
+	}
+
+	// the net mode the process was started for: no world exists yet when the log is opened
+	const TCHAR* GetProcessNetModeName()
+	{
+		if (IsRunningDedicatedServer()) { return TEXT("DedicatedServer"); }
+		if (IsRunningClientOnly()) { return TEXT("Client"); }
+
+		return FCString::Stristr(FCommandLine::Get(), TEXT("?listen")) ? TEXT("ListenServer") : TEXT("Game");
+	}
+
+	void Startup()
+	{
+		// commandlets, like the decoder, have nothing to record
+		if (IsRunningCommandlet() || FParse::Param(FCommandLine::Get(), TEXT("NoLawRoomTelemetry"))) { return; }
+
+		FDateTime StartDate = FDateTime::UtcNow();
+		// the server and the clients of a local test start in the same second, the process id and net mode keep their logs apart
+		FString Path = FPaths::Combine(FPaths::ProjectLogDir(), TEXT("LawRoomTelemetry"), FString::Printf(TEXT("Telemetry_%s_%s_%u.lrtl"),
+			*StartDate.ToString(), GetProcessNetModeName(), FPlatformProcess::GetCurrentProcessId()));
+
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Path));
+		IFileHandle* File = PlatformFile.OpenWrite(*Path);
+		if (!File)
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("Could not open the telemetry log %s"), *Path);
+			return;
+		}
+
+		FLawRoomTelemetryHeader Header;
+		Header.StartTicks = StartDate.GetTicks();
+
+		TArray<uint8> HeaderBytes;
+		FMemoryWriter HeaderWriter(HeaderBytes);
+		HeaderWriter << Header;
+		File->Write(HeaderBytes.GetData(), HeaderBytes.Num());
+
+		StartSeconds = FPlatformTime::Seconds();
+		DroppedRecords = 0;
+		Writer = new FWriter(File);
+
+		if (FPlatformProcess::SupportsMultithreading())
+		{
+			WriterThread = FRunnableThread::Create(Writer, TEXT("LawRoomTelemetryWriter"), 0, TPri_BelowNormal);
+		}
+		else
+		{
+			DrainTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+			{
+				Writer->Drain(false);
+				return true;
+			}), WakeUpMs / 1000.f);
+		}
+
+		bIsEnabled = true;
+		UE_LOG(LogLawRoom, Log, TEXT("Telemetry log %s"), *Path);
+	}
+
+	void Shutdown()
+	{
+		if (!bIsEnabled) { return; }
+
+		bIsEnabled = false;
+
+		if (WriterThread)
+		{
+			// stops and waits for the last drain
+			WriterThread->Kill(true);
+			delete WriterThread;
+			WriterThread = nullptr;
+		}
+		else
+		{
+			FTicker::GetCoreTicker().RemoveTicker(DrainTickerHandle);
+			Writer->Drain(true);
+		}
+
+		delete Writer;
+		Writer = nullptr;
+
+		if (DroppedRecords != 0)
+		{
+			UE_LOG(LogLawRoom, Warning, TEXT("%u telemetry events were dropped, the writer could not keep up"), DroppedRecords);
+		}
+	}
+}
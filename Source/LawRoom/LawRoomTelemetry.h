@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// ability events written to the telemetry log, the values are part of the file format: only add at the end
+enum class ELawRoomTelemetryEvent : uint8
+{
+	// Value: enemies in the room once it has spawned
+	RoomCast,
+	// Value: seconds the room lived
+	RoomDestroyed,
+	// Value: enemies in the room
+	LockOn,
+	LockOff,
+	// Value: direction of the change
+	TargetSwitch,
+	// Value: 1 for a chain injection shot
+	ShotRequested,
+	// Value: ms since the shot was requested
+	ShotStarted,
+	// Value: ms since the shot was requested
+	ShotFinished,
+	// Value: ms since the shot was requested
+	Kill,
+	NaniCamera,
+	FollowCamera,
+	Count
+};
+
+// "LRTL"
+static const uint32 LawRoomTelemetryMagic = 0x4C54524C;
+static const uint16 LawRoomTelemetryVersion = 1;
+
+// start of a telemetry file
+struct FLawRoomTelemetryHeader
+{
+	uint32 Magic = LawRoomTelemetryMagic;
+	uint16 Version = LawRoomTelemetryVersion;
+	// bytes of a serialized record, lets a decoder skip the fields it does not know
+	uint16 RecordSize = 17;
+	// UTC ticks of the log start, the records time is relative to it
+	int64 StartTicks = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FLawRoomTelemetryHeader& Header)
+	{
+		return Ar << Header.Magic << Header.Version << Header.RecordSize << Header.StartTicks;
+	}
+};
+
+struct FLawRoomTelemetryRecord
+{
+	ELawRoomTelemetryEvent Event = ELawRoomTelemetryEvent::Count;
+	// unique id of the ability owner
+	uint32 User = 0;
+	// microseconds since the log start
+	uint64 Time = 0;
+	float Value = 0.f;
+
+	friend FArchive& operator<<(FArchive& Ar, FLawRoomTelemetryRecord& Record)
+	{
+		uint8 Event = (uint8)Record.Event;
+		Ar << Event << Record.User << Record.Time << Record.Value;
+		Record.Event = (ELawRoomTelemetryEvent)Event;
+		return Ar;
+	}
+};
+
+// combat telemetry: the game thread pushes events into a lock free ring, a writer thread drains it into
+// Saved/Logs/LawRoomTelemetry/*.lrtl, decoded to csv by the LawRoomTelemetryDecode commandlet
+namespace LawRoomTelemetry
+{
+	// starts the writer thread, -NoLawRoomTelemetry disables the log
+	void Startup();
+	// drains the remaining events and closes the file
+	void Shutdown();
+
+	// game thread only, the event is dropped when the ring is full
+	void Record(ELawRoomTelemetryEvent Event, const UObject* User, float Value = 0.f);
+
+	const TCHAR* GetEventName(ELawRoomTelemetryEvent Event);
+}
+
+#define LAWROOM_TELEMETRY(Event, User, ...) LawRoomTelemetry::Record(ELawRoomTelemetryEvent::Event, User, ##__VA_ARGS__)
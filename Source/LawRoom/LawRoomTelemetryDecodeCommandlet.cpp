@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LawRoomTelemetryDecodeCommandlet.h"
+#include "LawRoom.h"
+#include "LawRoomTelemetry.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+
+ULawRoomTelemetryDecodeCommandlet::ULawRoomTelemetryDecodeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 ULawRoomTelemetryDecodeCommandlet::Main(const FString& Params)
+{
+	FString In;
+	if (!FParse::Value(*Params, TEXT("In="), In))
+	{
+		UE_LOG(LogLawRoom, Error, TEXT("Usage: -run=LawRoomTelemetryDecode -In=<File or folder of .lrtl> [-Out=<Folder>]"));
+		return 1;
+	}
+
+	TArray<FString> Files;
+	if (IFileManager::Get().DirectoryExists(*In))
+	{
+		IFileManager::Get().FindFiles(Files, *FPaths::Combine(In, TEXT("*.lrtl")), true, false);
+		for (FString& File : Files)
+		{
+			File = FPaths::Combine(In, File);
+		}
+	}
+	else
+	{
+		Files.Add(In);
+	}
+
+	int32 Failures = 0;
+	for (const FString& File : Files)
+	{
+		FString OutFolder = FPaths::GetPath(File);
+		FParse::Value(*Params, TEXT("Out="), OutFolder);
+
+		FString OutPath = FPaths::Combine(OutFolder, FPaths::GetBaseFilename(File) + TEXT(".csv"));
+		if (!DecodeFile(File, OutPath))
+		{
+			Failures++;
+		}
+	}
+
+	return (Failures == 0) ? 0 : 1;
+}
+
+bool ULawRoomTelemetryDecodeCommandlet::DecodeFile(const FString& InPath, const FString& OutPath) const
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *InPath))
+	{
+		UE_LOG(LogLawRoom, Error, TEXT("Could not read %s"), *InPath);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	FLawRoomTelemetryHeader Header;
+	Reader << Header;
+	if (Reader.IsError() || (Header.Magic != LawRoomTelemetryMagic) || (Header.Version > LawRoomTelemetryVersion) || (Header.RecordSize < 17))
+	{
+		UE_LOG(LogLawRoom, Error, TEXT("%s is not a telemetry log this decoder can read"), *InPath);
+		return false;
+	}
+
+	FString Csv = TEXT("TimeSeconds,Date,User,Event,Value\n");
+	int32 Records = 0;
+
+	// a log cut by a crash ends with a partial record, it is ignored
+	while (Reader.TotalSize() - Reader.Tell() >= Header.RecordSize)
+	{
+		int64 RecordStart = Reader.Tell();
+
+		FLawRoomTelemetryRecord Record;
+		Reader << Record;
+
+		// skip the fields added by newer versions
+		Reader.Seek(RecordStart + Header.RecordSize);
+
+		// FDateTime ticks are 100 ns
+		FDateTime Date(Header.StartTicks + (int64)Record.Time * 10);
+		Csv += FString::Printf(TEXT("%.6f,%s,%u,%s,%.3f\n"), Record.Time / 1000000.0, *Date.ToIso8601(), Record.User, LawRoomTelemetry::GetEventName(Record.Event), Record.Value);
+		Records++;
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutPath))
+	{
+		UE_LOG(LogLawRoom, Error, TEXT("Could not write %s"), *OutPath);
+		return false;
+	}
+
+	UE_LOG(LogLawRoom, Display, TEXT("Decoded %d events from %s to %s"), Records, *InPath, *OutPath);
+	return true;
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LawRoomTelemetryDecodeCommandlet.generated.h"
+
+// turns telemetry logs into csv: -run=LawRoomTelemetryDecode -In=<File or folder of .lrtl> [-Out=<Folder>]
+UCLASS()
+class ULawRoomTelemetryDecodeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+private:
+	// returns false when the file is not a telemetry log of a known version
+	bool DecodeFile(const FString& InPath, const FString& OutPath) const;
+
+public:
+	ULawRoomTelemetryDecodeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
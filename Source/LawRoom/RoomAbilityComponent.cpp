@@ -1,23 +1,66 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "RoomAbilityComponent.h"
+#include "LawRoom.h"
 #include "Components/TimelineComponent.h"
 #include "Enemy.h"
 #include "LawRoomCharacter.h"
+#include "KatanaHitDetectionComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "GameFramework/PlayerController.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components/SkeletalMeshComponent.h"
-#include "GameFramework/CharacterMovementComponent.h"
+#include "LawRoomMovementComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "Camera/CameraComponent.h"
+#include "EnemyAIScheduler.h"
+#include "LawRoomMemory.h"
+#include "LawRoomFrameCapture.h"
+#include "LawRoomGameMode.h"
+#include "ArenaStreamer.h"
+#include "EnemyCrowd.h"
+#include "LawRoomBotController.h"
+#include "LawRoomTelemetry.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarRagdollPrewarmsPerFrame(
+	TEXT("LawRoom.Ragdoll.PrewarmsPerFrame"),
+	2,
+	TEXT("Number of enemies entering a room whose rag doll is prewarmed per frame, 0 kills them cold (LawRoom scalability)"));
+
+static TAutoConsoleVariable<int32> CVarRagdollMaxActive(
+	TEXT("LawRoom.Ragdoll.MaxActive"),
+	0,
+	TEXT("Simulated rag dolls per player, the oldest ones are frozen (or hidden when still falling) above it, 0 for no limit (LawRoom scalability)"));
+
+static TAutoConsoleVariable<float> CVarRagdollMinSimulationTime(
+	TEXT("LawRoom.Ragdoll.MinSimulationTime"),
+	2.f,
+	TEXT("Seconds a rag doll still awake simulates before it can be frozen above LawRoom.Ragdoll.MaxActive, a younger one is dropped to the ground and hidden"));
+
+static TAutoConsoleVariable<int32> CVarRoomMaterialQuality(
+	TEXT("LawRoom.Room.MaterialQuality"),
+	1,
+	TEXT("0: plain room material without color animation, 1: full room material (LawRoom scalability)"));
+
+DECLARE_CYCLE_STAT(TEXT("Process Enemy Deaths"), STAT_ProcessEnemyDeaths, STATGROUP_LawRoom);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Death Batch Size"), STAT_EnemyDeathBatchSize, STATGROUP_LawRoom);
+DECLARE_CYCLE_STAT(TEXT("Score Lock On Targets"), STAT_ScoreLockOnTargets, STATGROUP_LawRoom);
+DECLARE_CYCLE_STAT(TEXT("Prewarm Rag Dolls"), STAT_PrewarmRagdolls, STATGROUP_LawRoom);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Cold Rag Doll Death (ms)"), STAT_ColdRagdollDeath, STATGROUP_LawRoom);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Prewarmed Rag Doll Death (ms)"), STAT_PrewarmedRagdollDeath, STATGROUP_LawRoom);
+DECLARE_CYCLE_STAT(TEXT("Room Update"), STAT_RoomUpdate, STATGROUP_LawRoom);
 
 // Sets default values for this component's properties
 URoomAbilityComponent::URoomAbilityComponent()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = false;
+	// ticks only at the end of frames where enemies died, to process their deaths together, or while rag dolls are prewarmed
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 
 	// setup SpawnRoomTimeline
 	SpawnRoomTimeline = CreateDefaultSubobject<UTimelineComponent>("SpawnRoomTimeline");
@@ -39,6 +82,15 @@ void URoomAbilityComponent::BeginPlay()
 
 	Player = Cast<ALawRoomCharacter>(GetOwner());
 
+	if (Player && ensure(Player->GetLawRoomMovement()))
+	{
+		Player->GetLawRoomMovement()->OnInjectionDashEnded.AddUObject(this, &URoomAbilityComponent::OnInjectionDashEnded);
+	}
+
+	LAWROOM_LLM_SCOPE(Room);
+
+	SetupTimelines();
+
 	// room setup
 	if (ensure(RoomMesh) && ensure(RoomMaterial))
 	{
@@ -52,9 +104,61 @@ void URoomAbilityComponent::BeginPlay()
 		Room->SetWorldScale3D(FVector::ZeroVector);
 		Room->SetGenerateOverlapEvents(true);
 		Room->OnComponentBeginOverlap.AddDynamic(this, &URoomAbilityComponent::OnRoomDetectedEnemy);
+		Room->OnComponentEndOverlap.AddDynamic(this, &URoomAbilityComponent::OnRoomLostEnemy);
+
+#if LAWROOM_WITH_COSMETICS
+		// create a dynamic material to change the color of the room over time, dedicated servers never see it
+		if (!IsNetMode(NM_DedicatedServer))
+		{
+			LAWROOM_LLM_SCOPE(RoomMaterials);
+
+			FName MaterialSlotName = Room->GetMaterialSlotNames()[0];
+			int32 MaterialIndex = Room->GetMaterialIndex(MaterialSlotName);
+			RoomDynamicMaterial = Room->CreateDynamicMaterialInstance(MaterialIndex, Room->GetMaterial(MaterialIndex));
+		}
 
 		// setup RoomBaseColor
-		GetRoomDynamicMaterial()->GetVectorParameterValue(FMaterialParameterInfo("BaseColor"), RoomBaseColor);
+		if (RoomDynamicMaterial)
+		{
+			RoomDynamicMaterial->GetVectorParameterValue(FMaterialParameterInfo("BaseColor"), RoomBaseColor);
+		}
+#endif
+	}
+}
+
+void URoomAbilityComponent::SetupTimelines()
+{
+	float Min;
+
+	if (ensure(SpawnTimeCurve))
+	{
+		FOnTimelineFloat SpawnRoomDelegate;
+		SpawnRoomDelegate.BindUFunction(this, "SpawnRoom");
+
+		FOnTimelineEventStatic OnRoomFinishedSpawn;
+		OnRoomFinishedSpawn.BindUFunction(this, "ChangeColor");
+		SpawnRoomTimeline->SetTimelineFinishedFunc(OnRoomFinishedSpawn);
+
+		float RoomSpawnDuration;
+		SpawnTimeCurve->GetTimeRange(Min, RoomSpawnDuration);
+		SpawnRoomTimeline->SetTimelineLength(RoomSpawnDuration);
+		SpawnRoomTimeline->AddInterpFloat(SpawnTimeCurve, SpawnRoomDelegate, "Value");
+	}
+
+	if (ensure(RoomColorCurve))
+	{
+		// set RoomLifeSpan
+		RoomColorCurve->GetTimeRange(Min, RoomLifeSpan);
+
+		FOnTimelineEventStatic DestroyRoomDelegate;
+		DestroyRoomDelegate.BindUFunction(this, "DestroyRoom");
+		UpdateColorTimeline->SetTimelineFinishedFunc(DestroyRoomDelegate);
+
+		FOnTimelineFloat UpdateColorDelegate;
+		UpdateColorDelegate.BindUFunction(this, "UpdateRoomColor");
+
+		UpdateColorTimeline->SetTimelineLength(RoomLifeSpan);
+		UpdateColorTimeline->AddInterpFloat(RoomColorCurve, UpdateColorDelegate, "Alpha");
 	}
 }
 
@@ -63,6 +167,13 @@ void URoomAbilityComponent::TickComponent(float DeltaTime, ELevelTick TickType,
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	ProcessPendingDeaths();
+	ProcessRagdollPrewarms();
+
+	if (RagdollPrewarmQueue.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
 }
 
 void URoomAbilityComponent::SetupPlayerKatana(UStaticMeshComponent* PlayerKatana)
@@ -71,17 +182,18 @@ void URoomAbilityComponent::SetupPlayerKatana(UStaticMeshComponent* PlayerKatana
 	{
 		Katana = PlayerKatana;
 
-		// setup katana collision 
-		Katana->SetGenerateOverlapEvents(true);
-		Katana->SetCollisionProfileName("OverlapAll");
-		Katana->SetCollisionObjectType(ECC_WorldDynamic);
-		Katana->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
-		Katana->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
-		Katana->SetCollisionResponseToChannel(ECC_Visibility, ECR_Ignore);
+		// the katana hits are detected by sweeping the blade during the attack window, so the mesh itself never overlaps
+		Katana->SetGenerateOverlapEvents(false);
+		Katana->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		Katana->CanCharacterStepUpOn = ECanBeCharacterBase::ECB_No;
 
-		//
-		Katana->OnComponentBeginOverlap.AddDynamic(this, &URoomAbilityComponent::OnKatanaCollidedWithEnemy);
+		// the katana can be set up before BeginPlay, so the owner is used instead of Player
+		ALawRoomCharacter* OwnerCharacter = Cast<ALawRoomCharacter>(GetOwner());
+		if (OwnerCharacter && ensure(OwnerCharacter->GetKatanaHitDetection()))
+		{
+			OwnerCharacter->GetKatanaHitDetection()->SetupKatana(Katana);
+			OwnerCharacter->GetKatanaHitDetection()->OnKatanaHit.AddUniqueDynamic(this, &URoomAbilityComponent::OnKatanaCollidedWithEnemy);
+		}
 	}
 }
 
@@ -91,6 +203,8 @@ void URoomAbilityComponent::CreateRoom()
 	{
 		Player->GetCharacterMovement()->DisableMovement();
 
+		UpdateRoomMaterial();
+
 		// reset room base color
 		if (GetRoomDynamicMaterial())
 		{
@@ -99,23 +213,10 @@ void URoomAbilityComponent::CreateRoom()
 		}
 
 		bIsCreatingRoom = true;
+		LAWROOM_FRAME_EVENT(CreateRoom);
 
-		// set RoomLifeSpan
-		float Min;
-		RoomColorCurve->GetTimeRange(Min, RoomLifeSpan);
+		RoomCastTime = FPlatformTime::Seconds();
 
-		FOnTimelineFloat SpawnRoomDelegate;
-		SpawnRoomDelegate.BindUFunction(this, "SpawnRoom");
-		
-		FOnTimelineEventStatic OnRoomFinishedSpawn;
-		OnRoomFinishedSpawn.BindUFunction(this, "ChangeColor");
-		SpawnRoomTimeline->SetTimelineFinishedFunc(OnRoomFinishedSpawn);
-
-		float RoomSpawnDuration;
-		SpawnTimeCurve->GetTimeRange(Min, RoomSpawnDuration);
-		SpawnRoomTimeline->SetTimelineLength(RoomSpawnDuration);
-		SpawnRoomTimeline->AddInterpFloat(SpawnTimeCurve, SpawnRoomDelegate, "Value");
-	
 		Player->PlayAnimMontage(RoomSpawnAnim);
 		//SpawnRoomTimeline->PlayFromStart(); it will be called by an anim notify
 
@@ -123,11 +224,28 @@ void URoomAbilityComponent::CreateRoom()
 
 		Room->DetachFromParent(true);
 		Room->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+
+		FSphere RoomSphere(Room->GetComponentLocation(), RoomRadius * 100.f);
+
+		// start streaming the arena cells the room will reach while it spawns
+		if (AArenaStreamer* ArenaStreamer = GetArenaStreamer())
+		{
+			ArenaStreamer->RequestCellsInSphere(RoomSphere);
+		}
+
+		// the crowd enemies the room will reach are spawned back now, before the room overlaps start
+		if (AEnemyCrowd* EnemyCrowd = GetEnemyCrowd())
+		{
+			EnemyCrowd->PromoteEnemiesInSphere(RoomSphere);
+		}
 	}
 }
 
 void URoomAbilityComponent::SpawnRoom(float Alpha)
 {
+	SCOPE_CYCLE_COUNTER(STAT_RoomUpdate);
+
+	// the room scale is gameplay: it drives the enemies overlap
 	float NewRadius = FMath::Lerp<float>(0.f, RoomRadius, Alpha);
 	Room->SetWorldScale3D(UKismetMathLibrary::Conv_FloatToVector(NewRadius));
 }
@@ -137,6 +255,18 @@ void URoomAbilityComponent::SetRoomSpawnLocation(const FVector& SpawnLocation)
 	if (Room)
 	{
 		Room->SetWorldLocation(SpawnLocation);
+
+		FSphere RoomSphere(SpawnLocation, RoomRadius * 100.f);
+
+		if (AArenaStreamer* ArenaStreamer = GetArenaStreamer())
+		{
+			ArenaStreamer->RequestCellsInSphere(RoomSphere);
+		}
+
+		if (AEnemyCrowd* EnemyCrowd = GetEnemyCrowd())
+		{
+			EnemyCrowd->PromoteEnemiesInSphere(RoomSphere);
+		}
 	}
 }
 
@@ -144,53 +274,81 @@ void URoomAbilityComponent::ChangeColor()
 {
 	if (ensure(RoomColorCurve) && bIsCreatingRoom)
 	{
-		FOnTimelineEventStatic DestroyRoomDelegate;
-		DestroyRoomDelegate.BindUFunction(this, "DestroyRoom");
-		UpdateColorTimeline->SetTimelineFinishedFunc(DestroyRoomDelegate);
+		// the room is spawned: every enemy of the cells it reaches must be there
+		FSphere RoomSphere;
+		AArenaStreamer* ArenaStreamer = GetArenaStreamer();
+		if (ArenaStreamer && GetRoomSphere(RoomSphere))
+		{
+			ArenaStreamer->MakeCellsResident(RoomSphere);
 
-		FOnTimelineFloat UpdateColorDelegate;
-		UpdateColorDelegate.BindUFunction(this, "UpdateRoomColor");
+			// streamed in enemies do not generate overlaps on their own
+			Room->UpdateOverlaps();
+		}
 
-		UpdateColorTimeline->SetTimelineLength(RoomLifeSpan);
-		UpdateColorTimeline->AddInterpFloat(RoomColorCurve, UpdateColorDelegate, "Alpha");
+		// recorded once the room has grown to its full size, before that it has no enemies yet
+		LAWROOM_TELEMETRY(RoomCast, GetOwner(), Enemies.Num());
 
 		UpdateColorTimeline->PlayFromStart();
 	}
 }
 
-void URoomAbilityComponent::UpdateRoomColor(float Alpha)
+void URoomAbilityComponent::UpdateRoomMaterial()
 {
-	if (GetRoomDynamicMaterial())
+#if LAWROOM_WITH_COSMETICS
+	if (!GetRoomDynamicMaterial() || !RoomMaterial) { return; }
+
+	// the low path is RoomMaterial itself: the room keeps its base color and no parameter is pushed to the render thread every frame
+	UMaterialInterface* Material = (CVarRoomMaterialQuality.GetValueOnGameThread() == 0) ? RoomMaterial : GetRoomDynamicMaterial();
+	if (Room->GetMaterial(0) != Material)
 	{
-		FLinearColor LifeEndColor = UKismetMathLibrary::LinearColorLerp(RoomBaseColor, FLinearColor::Red, Alpha);
-		GetRoomDynamicMaterial()->SetVectorParameterValue("BaseColor", LifeEndColor);	
+		Room->SetMaterial(0, Material);
 	}
+#endif
 }
 
-UMaterialInstanceDynamic* URoomAbilityComponent::GetRoomDynamicMaterial() const
+void URoomAbilityComponent::UpdateRoomColor(float Alpha)
 {
-	if (Room)
-	{
-		// create a dynamic material to change the color of the room over time
-		FName MaterialSlotName = Room->GetMaterialSlotNames()[0];
-		int32 MaterialIndex = Room->GetMaterialIndex(MaterialSlotName);
-		UMaterialInstanceDynamic* DynamicMat = Room->CreateDynamicMaterialInstance(MaterialIndex, Room->GetMaterial(MaterialIndex));
+	SCOPE_CYCLE_COUNTER(STAT_RoomUpdate);
 
-		return DynamicMat;
+	// the timeline still runs on servers, it ends the room life
+#if LAWROOM_WITH_COSMETICS
+	// the plain material has no color to animate
+	if (GetRoomDynamicMaterial() && (Room->GetMaterial(0) == GetRoomDynamicMaterial()))
+	{
+		FLinearColor LifeEndColor = UKismetMathLibrary::LinearColorLerp(RoomBaseColor, FLinearColor::Red, Alpha);
+		GetRoomDynamicMaterial()->SetVectorParameterValue("BaseColor", LifeEndColor);	
 	}
-
-	return nullptr;
+#endif
 }
 
 void URoomAbilityComponent::DestroyRoom()
 {
+	LAWROOM_FRAME_EVENT(DestroyRoom);
+
+	if (bIsCreatingRoom)
+	{
+		LAWROOM_TELEMETRY(RoomDestroyed, GetOwner(), (float)(FPlatformTime::Seconds() - RoomCastTime));
+	}
+
 	if (Room)
 	{
 		SpawnRoomTimeline->ReverseFromEnd();
 		Room->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	}
 
+	// the enemies left alive are out of danger
+	for (AEnemy* const Enemy : Enemies)
+	{
+		if (Enemy)
+		{
+			Enemy->ReleaseRagdoll();
+		}
+	}
+	RagdollPrewarmQueue.Empty();
+
 	Enemies.Empty();
+	ChainTargets.Empty();
+	bIsChainShot = false;
 	bIsFocused = false;
 	bCanCreateRoom = true;
 	bIsCreatingRoom = false;
@@ -198,6 +356,7 @@ void URoomAbilityComponent::DestroyRoom()
 	if (Player)
 	{
 		Player->bUseControllerRotationYaw = false;
+		Player->GetKatanaHitDetection()->EndHitWindow();
 		Player->StopAnimMontage(InjectionShotAnim);
 		bIsInjectionShot = false;
 	}
@@ -208,49 +367,133 @@ void URoomAbilityComponent::OnRoomDetectedEnemy(UPrimitiveComponent* OverlappedC
 	AEnemy* Enemy = Cast<AEnemy>(OtherActor);
 	if (Enemy)
 	{
+		// the room may overlap several components of the enemy, the capsule alone counts for the scheduler
+		AEnemyAIScheduler* AIScheduler = Enemy->FindAIScheduler();
+		if (AIScheduler && (OtherComp == Enemy->GetRootComponent()))
+		{
+			AIScheduler->OnEnemyEnteredRoom(Enemy);
+		}
+
 		if (!Enemy->GetIsDead())
 		{
 			Enemies.AddUnique(Enemy);
+
+			// enemies in the room are the ones that can die, get their rag doll ready over the next frames
+			if (!Enemy->GetIsRagdollPrewarmed())
+			{
+				RagdollPrewarmQueue.AddUnique(Enemy);
+				SetComponentTickEnabled(true);
+			}
 		}
 	}
 }
 
+void URoomAbilityComponent::OnRoomLostEnemy(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	AEnemy* Enemy = Cast<AEnemy>(OtherActor);
+	AEnemyAIScheduler* AIScheduler = Enemy ? Enemy->FindAIScheduler() : nullptr;
+	if (AIScheduler && (OtherComp == Enemy->GetRootComponent()))
+	{
+		AIScheduler->OnEnemyLeftRoom(Enemy);
+	}
+}
+
 class AEnemy* URoomAbilityComponent::GetClosestEnemy() const
 {
-	if (Enemies.Num() != 0) 
+	SCOPE_CYCLE_COUNTER(STAT_ScoreLockOnTargets);
+	LAWROOM_FRAME_SCOPE(TargetScoring);
+
+	if ((Enemies.Num() != 0) && Player)
 	{
-		AEnemy* ClosestEnemy = nullptr;
-		for (AEnemy* const Enemy : Enemies)
+		// the scheduler is only there on the server, scoring never spawns it
+		ALawRoomGameMode* GameMode = GetWorld()->GetAuthGameMode<ALawRoomGameMode>();
+		AEnemyAIScheduler* AIScheduler = GameMode ? GameMode->FindEnemyAIScheduler() : nullptr;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		Player->GetActorEyesViewPoint(ViewLocation, ViewRotation);
+
+		// snapshot the enemies then score them all in one pass
+		TargetSnapshot.Reset(Enemies.Num());
+		for (int32 Index = 0; Index < Enemies.Num(); Index++)
 		{
-			if (Enemy->WasRecentlyRendered(0.1))
-			{
-				ClosestEnemy = Enemy; 
-				break;
-			}
+			AEnemy* const Enemy = Enemies[Index];
+			EEnemyAIState State = AIScheduler ? AIScheduler->GetEnemyState(Enemy) : EEnemyAIState::Idle;
+			bool bIsThreat = (State == EEnemyAIState::Chase) || (State == EEnemyAIState::Flank);
+
+			TargetSnapshot.Set(Index, Enemy->GetActorLocation(), IsEnemyInSight(Enemy, ViewLocation, ViewRotation.Vector()), bIsThreat ? 1.f : 0.f);
+		}
+
+		FVector Forward = Player->GetFollowCamera()->GetForwardVector();
+		bool bParallel = Enemies.Num() > ParallelTargetScoringThreshold;
+		EnemyTargetScoring::Score<FLockOnScoringPolicy>(TargetSnapshot, Player->GetActorLocation(), Forward, TargetScoringMaxDistance, bParallel);
+
+		// visibility is one of the weighted criteria: a hidden enemy can still win when it is close and in front
+		int32 BestIndex = TargetSnapshot.GetBestIndex();
+		if (BestIndex != INDEX_NONE)
+		{
+			return Enemies[BestIndex];
+		}
+	}
+
+	return nullptr;
+}
+
+void URoomAbilityComponent::GetChainTargets(TArray<AEnemy*>& Targets) const
+{
+	Targets.Reset();
+
+	if (!Player) { return; }
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Player->GetActorEyesViewPoint(ViewLocation, ViewRotation);
+
+	TArray<AEnemy*> Candidates;
+	for (AEnemy* const Enemy : Enemies)
+	{
+		if (Enemy && !Enemy->GetIsDead() && IsEnemyInSight(Enemy, ViewLocation, ViewRotation.Vector()))
+		{
+			Candidates.Add(Enemy);
 		}
+	}
 
-		float MinDistance = CalculateDistance(ClosestEnemy);
-		for (AEnemy* const Enemy : Enemies)
+	// greedy nearest neighbour: each dash goes to the closest enemy from the end of the previous one
+	FVector From = Player->GetActorLocation();
+	while ((Candidates.Num() != 0) && (Targets.Num() < MaxChainTargets))
+	{
+		int32 ClosestIndex = 0;
+		float MinDistance = FVector::DistSquared(From, Candidates[0]->GetActorLocation());
+		for (int32 Index = 1; Index < Candidates.Num(); Index++)
 		{
-			if (Enemy->WasRecentlyRendered(0.1))
+			float Distance = FVector::DistSquared(From, Candidates[Index]->GetActorLocation());
+			if (Distance < MinDistance)
 			{
-				if (CalculateDistance(Enemy) < MinDistance)
-				{
-					MinDistance = CalculateDistance(Enemy);
-					ClosestEnemy = Enemy;
-				}
+				MinDistance = Distance;
+				ClosestIndex = Index;
 			}
 		}
 
-		return ClosestEnemy;
+		AEnemy* Closest = Candidates[ClosestIndex];
+		Targets.Add(Closest);
+		From = Closest->GetActorLocation();
+		Candidates.RemoveAtSwap(ClosestIndex);
 	}
-
-	return nullptr;
 }
 
-float URoomAbilityComponent::CalculateDistance(class AEnemy* Enemy) const
+bool URoomAbilityComponent::IsEnemyInSight(const AEnemy* Enemy, const FVector& ViewLocation, const FVector& ViewDirection) const
 {
-	return (Enemy && Player) ? (Player->GetActorLocation() - Enemy->GetActorLocation()).Size() : 0.f;
+	FVector EnemyLocation = Enemy->GetActorLocation();
+	FVector ToEnemy = EnemyLocation - ViewLocation;
+
+	// the cone first, the trace only for the enemies in it
+	float Distance = ToEnemy.Size();
+	if ((Distance > KINDA_SMALL_NUMBER) && ((ToEnemy | ViewDirection) < Distance * FMath::Cos(FMath::DegreesToRadians(SightHalfAngle)))) { return false; }
+
+	// only the level hides enemies, the other enemies and the room do not
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(EnemySight), false, GetOwner());
+	QueryParams.AddIgnoredActor(Enemy);
+	return !GetWorld()->LineTraceTestByObjectType(ViewLocation, EnemyLocation, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams);
 }
 
 void URoomAbilityComponent::LockOnTarget()
@@ -265,12 +508,14 @@ void URoomAbilityComponent::LockOnTarget()
 				Player->bUseControllerRotationYaw = false;
 				LockedOnEnemy = nullptr;
 				bIsFocused = false;
+				LAWROOM_TELEMETRY(LockOff, GetOwner());
 			}
 			else
 			{
 				Player->bUseControllerRotationYaw = true;
 				LookAtEnemy();
 				bIsFocused = true;
+				LAWROOM_TELEMETRY(LockOn, GetOwner(), Enemies.Num());
 			}
 		}
 		else
@@ -288,12 +533,13 @@ void URoomAbilityComponent::LookAtEnemy()
 	{
 		if (CheckPlayerInsideRoom(Player))
 		{
-			APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
-			if (PlayerController)
+			// the owner controller, a player or a bot
+			AController* Controller = Player->GetController();
+			if (Controller)
 			{
 				FRotator LookAtRotation = UKismetMathLibrary::FindLookAtRotation(Player->GetActorLocation(), LockedOnEnemy->GetActorLocation());
 				FRotator NewRotation = FRotator(LookAtRotation.Pitch - 30.f, LookAtRotation.Yaw, LookAtRotation.Roll);
-				PlayerController->SetControlRotation(NewRotation);
+				Controller->SetControlRotation(NewRotation);
 			}
 		}
 		else
@@ -305,6 +551,22 @@ void URoomAbilityComponent::LookAtEnemy()
 
 }
 
+void URoomAbilityComponent::GetRoomUsers(const UWorld* World, TArray<APawn*>& OutUsers)
+{
+	OutUsers.Reset();
+	if (!World) { return; }
+
+	for (FConstControllerIterator It = World->GetControllerIterator(); It; ++It)
+	{
+		AController* Controller = It->Get();
+		APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+		if (Pawn && (Controller->IsPlayerController() || Controller->IsA<ALawRoomBotController>()))
+		{
+			OutUsers.Add(Pawn);
+		}
+	}
+}
+
 bool URoomAbilityComponent::CheckPlayerInsideRoom(ALawRoomCharacter* Player) const
 {
 	if (Player && Room)
@@ -318,6 +580,23 @@ bool URoomAbilityComponent::CheckPlayerInsideRoom(ALawRoomCharacter* Player) con
 	return false;
 }
 
+bool URoomAbilityComponent::GetRoomSphere(FSphere& OutSphere) const
+{
+	if (Room && bIsCreatingRoom)
+	{
+		// RoomRadius * 100: unreal unit is cm and the radius is in meter
+		OutSphere = FSphere(Room->GetComponentLocation(), RoomRadius * 100);
+		return true;
+	}
+
+	return false;
+}
+
+bool URoomAbilityComponent::IsEnemyInUse(const AEnemy* Enemy) const
+{
+	return Enemy && ((LockedOnEnemy == Enemy) || Enemies.Contains(Enemy) || ChainTargets.Contains(Enemy));
+}
+
 void URoomAbilityComponent::ChangeTarget(float Value)
 {
 	if (bIsFocused && (Enemies.Num() != 0) && LockedOnEnemy && (Value != 0))
@@ -329,6 +608,7 @@ void URoomAbilityComponent::ChangeTarget(float Value)
 			Index = (Index < 0) ? Enemies.Num() + Index : Index;
 
 			LockedOnEnemy = Enemies[Index];
+			LAWROOM_TELEMETRY(TargetSwitch, GetOwner(), Value);
 		}
 	}
 }
@@ -337,11 +617,14 @@ void URoomAbilityComponent::RequestInjectionShot()
 {
 	if (LockedOnEnemy && bIsFocused && Player && !bIsInjectionShot && CheckPlayerInsideRoom(Player))
 	{
+		ShotRequestTime = FPlatformTime::Seconds();
+		LAWROOM_TELEMETRY(ShotRequested, GetOwner(), bIsChainShot ? 1.f : 0.f);
+
 		// prevent the room from being destroyed when performing injection shot (pause it's life progression)
 		UpdateColorTimeline->Stop();
 
-		// disable player input when performing attack
-		APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+		// disable player input when performing attack, bots have none
+		APlayerController* PlayerController = Cast<APlayerController>(Player->GetController());
 		if (PlayerController)
 		{
 			Player->DisableInput(PlayerController);
@@ -351,18 +634,38 @@ void URoomAbilityComponent::RequestInjectionShot()
 	}
 }
 
+void URoomAbilityComponent::RequestChainInjectionShot()
+{
+	if (Player && !bIsInjectionShot && CheckPlayerInsideRoom(Player))
+	{
+		GetChainTargets(ChainTargets);
+		if (ChainTargets.Num() != 0)
+		{
+			bIsChainShot = true;
+
+			// lock on the first target, the rest of the flow is the same as the single injection shot
+			LockedOnEnemy = ChainTargets[0];
+			bIsFocused = true;
+			Player->bUseControllerRotationYaw = true;
+			LookAtEnemy();
+
+			RequestInjectionShot();
+		}
+	}
+}
+
 void URoomAbilityComponent::InjectionShot()
 {
 	if (LockedOnEnemy && bIsFocused && ensure(InjectionShotAnim) && Player && CheckPlayerInsideRoom(Player))
 	{
 		bIsInjectionShot = true;
-		Player->PlayAnimMontage(InjectionShotAnim);
+		LAWROOM_TELEMETRY(ShotStarted, GetOwner(), GetMsSinceShotRequest());
 
-		FVector LaunchDirection = UKismetMathLibrary::GetDirectionUnitVector(Player->GetActorLocation(), LockedOnEnemy->GetActorLocation());
-		float LaunchForce = (Player->GetActorLocation() - LockedOnEnemy->GetActorLocation()).Size() * 20.f;
-		FVector LaunchVelocity = LaunchDirection * LaunchForce;
-
-		Player->LaunchCharacter(LaunchVelocity, true, true);
+		if (bIsChainShot)
+		{
+			ChainTargets.Remove(LockedOnEnemy);
+		}
+		DashToEnemy(LockedOnEnemy);
 
 		bIsFocused = false;
 		LockedOnEnemy = nullptr;
@@ -370,48 +673,264 @@ void URoomAbilityComponent::InjectionShot()
 	}
 }
 
-void URoomAbilityComponent::UpdateEnemyStatus(AEnemy* Enemy)
+void URoomAbilityComponent::DashToEnemy(AEnemy* Enemy)
 {
-	if (Enemy)
+	if (Enemy && Player && ensure(InjectionShotAnim))
 	{
-		// disable enemy capsule component collision with the player pawn and katana
-		Enemy->GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+		LAWROOM_FRAME_EVENT(InjectionShot);
+
+		// restarting the montage opens a new katana hit window for every dash
+		Player->PlayAnimMontage(InjectionShotAnim);
+
+		// the katana strikes during the whole dash, a hit window notify on the montage is not required
+		Player->GetKatanaHitDetection()->BeginHitWindow();
+
+		// dash toward the enemy with fixed substeps, the dash stops when the player capsule reaches the enemy
+		if (ensure(Player->GetLawRoomMovement()))
+		{
+			DashedEnemy = Enemy;
+			Player->GetLawRoomMovement()->StartInjectionDash(Enemy->GetActorLocation());
+		}
+	}
+}
+
+void URoomAbilityComponent::OnInjectionDashEnded(const FHitResult& BlockingHit)
+{
+	if (!bIsInjectionShot) { return; }
+
+	// the last sweep of the window may hit the target and finish a single shot
+	Player->GetKatanaHitDetection()->EndHitWindow();
+	if (!bIsInjectionShot) { return; }
+
+	// a single shot that missed is over when its dash is, the player gets the control back
+	if (!bIsChainShot)
+	{
+		FinishInjectionShot();
+		return;
+	}
+
+	// the dash ended on its target: it dies before the next dash starts, the katana hit window may not have caught it;
+	// a dash stopped by a wall or another enemy, or short of its end, skips it
+	AEnemy* DashedTarget = DashedEnemy;
+	DashedEnemy = nullptr;
+	if (DashedTarget && IsEnemyInReach(DashedTarget, BlockingHit))
+	{
+		UpdateEnemyStatus(DashedTarget);
+	}
+
+	// skip the targets that died on the way
+	ChainTargets.RemoveAll([](AEnemy* Enemy) { return !Enemy || Enemy->GetIsDead(); });
+
+	if (ChainTargets.Num() != 0)
+	{
+		AEnemy* NextTarget = ChainTargets[0];
+		ChainTargets.RemoveAt(0);
+		NextTarget->LookAt(Player);
+		DashToEnemy(NextTarget);
+	}
+	else
+	{
+		FinishInjectionShot();
+	}
+}
+
+bool URoomAbilityComponent::IsEnemyInReach(const AEnemy* Enemy, const FHitResult& BlockingHit) const
+{
+	if (!Enemy || !Player) { return false; }
+
+	if (BlockingHit.GetActor() == Enemy) { return true; }
+
+	float Reach = Player->GetCapsuleComponent()->GetScaledCapsuleRadius() + Enemy->GetCapsuleComponent()->GetScaledCapsuleRadius() + InjectionShotReach;
+	return FVector::DistSquared2D(Player->GetActorLocation(), Enemy->GetActorLocation()) <= FMath::Square(Reach);
+}
+
+void URoomAbilityComponent::FinishInjectionShot()
+{
+	bIsChainShot = false;
+	ChainTargets.Empty();
+	DashedEnemy = nullptr;
+
+	if (Player && ensure(InjectionShotAnim))
+	{
+		Player->GetKatanaHitDetection()->EndHitWindow();
+		Player->StopAnimMontage(InjectionShotAnim);
+		bIsInjectionShot = false;
+		LAWROOM_TELEMETRY(ShotFinished, GetOwner(), GetMsSinceShotRequest());
+
+		// continue room's life progression
+		UpdateColorTimeline->Play();
+
+		// enable back player input after performing attack
+		APlayerController* PlayerController = Cast<APlayerController>(Player->GetController());
+		if (PlayerController)
+		{
+			Player->EnableInput(PlayerController);
+		}
+	}
+}
+
+float URoomAbilityComponent::GetMsSinceShotRequest() const
+{
+	return (float)((FPlatformTime::Seconds() - ShotRequestTime) * 1000.0);
+}
 
-		//Rag doll death
-		Enemy->GetMesh()->SetAllBodiesBelowSimulatePhysics(FName("pelvis"), true, true);
-		Enemy->GetMesh()->SetAllBodiesBelowPhysicsBlendWeight(FName("pelvis"), 1.f);
+AArenaStreamer* URoomAbilityComponent::GetArenaStreamer() const
+{
+	// the game mode only exists on the server
+	ALawRoomGameMode* GameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALawRoomGameMode>() : nullptr;
+	return GameMode ? GameMode->GetArenaStreamer() : nullptr;
+}
+
+AEnemyCrowd* URoomAbilityComponent::GetEnemyCrowd() const
+{
+	ALawRoomGameMode* GameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALawRoomGameMode>() : nullptr;
+	return GameMode ? GameMode->GetEnemyCrowd() : nullptr;
+}
+
+void URoomAbilityComponent::UpdateEnemyStatus(AEnemy* Enemy)
+{
+	if (Enemy && !Enemy->GetIsDead())
+	{
 		Enemy->SetIsDead(true);
+		LAWROOM_TELEMETRY(Kill, GetOwner(), GetMsSinceShotRequest());
 
-		// launch enemy
-		FVector LaunchDirection = Katana->GetRightVector() * 700.f;
-		Enemy->GetMesh()->AddImpulseToAllBodiesBelow(LaunchDirection, "pelvis", true);
+		// the launch direction is taken now, while the katana is still in the enemy
+		FPendingEnemyDeath Death;
+		Death.Enemy = Enemy;
+		Death.Impulse = Katana ? Katana->GetRightVector() * 700.f : FVector::ZeroVector;
+		PendingDeaths.Add(Death);
 
 		//delete dead enemies from the array
 		Enemies.Remove(Enemy);
+
+		// the deaths are processed in TickComponent at the end of this frame
+		SetComponentTickEnabled(true);
 	}
 }
 
-void URoomAbilityComponent::OnKatanaCollidedWithEnemy(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void URoomAbilityComponent::ProcessPendingDeaths()
 {
-	AEnemy* Enemy = Cast<AEnemy>(OtherActor);
-	if (Enemy && bIsInjectionShot)
-	{	
-		UpdateEnemyStatus(Enemy);
+	SCOPE_CYCLE_COUNTER(STAT_ProcessEnemyDeaths);
+	LAWROOM_FRAME_SCOPE(Deaths);
+	LAWROOM_LLM_SCOPE(Ragdoll);
+	SET_DWORD_STAT(STAT_EnemyDeathBatchSize, PendingDeaths.Num());
 
-		if (Player && ensure(InjectionShotAnim))
+	if (PendingDeaths.Num() == 0) { return; }
+
+	LAWROOM_FRAME_EVENT(RagdollActivation);
+
+	// each step is done for the whole batch before the next one
+
+	// disable enemy capsule component collision with the player pawn and katana
+	for (const FPendingEnemyDeath& Death : PendingDeaths)
+	{
+		if (AEnemy* Enemy = Death.Enemy.Get())
+		{
+			Enemy->GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+		}
+	}
+
+	//Rag doll death
+	for (const FPendingEnemyDeath& Death : PendingDeaths)
+	{
+		if (AEnemy* Enemy = Death.Enemy.Get())
 		{
-			Player->StopAnimMontage(InjectionShotAnim);
-			bIsInjectionShot = false;
+			uint32 StartCycles = FPlatformTime::Cycles();
 
-			// continue room's life progression
-			UpdateColorTimeline->Play();
+			Enemy->StartRagdoll();
 
-			// enable back player input after performing attack
-			APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
-			if (PlayerController)
+			// compare the cost of killing an enemy with and without its rag doll prewarmed
+			float DeathMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+			if (Enemy->GetIsRagdollPrewarmed())
 			{
-				Player->EnableInput(PlayerController);
+				SET_FLOAT_STAT(STAT_PrewarmedRagdollDeath, DeathMs);
 			}
+			else
+			{
+				SET_FLOAT_STAT(STAT_ColdRagdollDeath, DeathMs);
+			}
+
+			// a lowered animation rate would make the rag doll stutter
+			Enemy->GetMesh()->SetComponentTickInterval(0.f);
+			ActiveRagdolls.Add(Enemy);
+		}
+	}
+
+#if LAWROOM_WITH_COSMETICS
+	// launch enemies, only for the eyes
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		for (const FPendingEnemyDeath& Death : PendingDeaths)
+		{
+			if (AEnemy* Enemy = Death.Enemy.Get())
+			{
+				Enemy->GetMesh()->AddImpulseToAllBodiesBelow(Death.Impulse, "pelvis", true);
+			}
+		}
+	}
+#endif
+
+	PendingDeaths.Reset();
+
+	LimitActiveRagdolls();
+}
+
+void URoomAbilityComponent::LimitActiveRagdolls()
+{
+	ActiveRagdolls.RemoveAll([](const TWeakObjectPtr<AEnemy>& Enemy) { return !Enemy.IsValid(); });
+
+	int32 MaxActive = CVarRagdollMaxActive.GetValueOnGameThread();
+	if ((MaxActive <= 0) || (ActiveRagdolls.Num() <= MaxActive)) { return; }
+
+	int32 Frozen = ActiveRagdolls.Num() - MaxActive;
+	float MinSimulationTime = CVarRagdollMinSimulationTime.GetValueOnGameThread();
+	for (int32 Index = 0; Index < Frozen; Index++)
+	{
+		// only a rag doll at rest keeps its pose, the others would be frozen in the air
+		AEnemy* Enemy = ActiveRagdolls[Index].Get();
+		if (!Enemy->GetMesh()->RigidBodyIsAwake() || (Enemy->GetRagdollSimulationTime() >= MinSimulationTime))
+		{
+			Enemy->FreezeRagdoll();
+		}
+		else
+		{
+			Enemy->DropRagdoll();
+		}
+	}
+	ActiveRagdolls.RemoveAt(0, Frozen, false);
+}
+
+void URoomAbilityComponent::ProcessRagdollPrewarms()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PrewarmRagdolls);
+	LAWROOM_FRAME_SCOPE(RagdollPrewarm);
+
+	int32 Prewarmed = 0;
+	while ((RagdollPrewarmQueue.Num() != 0) && (Prewarmed < CVarRagdollPrewarmsPerFrame.GetValueOnGameThread()))
+	{
+		AEnemy* Enemy = RagdollPrewarmQueue[0].Get();
+		RagdollPrewarmQueue.RemoveAt(0, 1, false);
+
+		if (Enemy && !Enemy->GetIsDead() && !Enemy->GetIsRagdollPrewarmed())
+		{
+			Enemy->PrewarmRagdoll();
+			LAWROOM_FRAME_EVENT(RagdollPrewarm);
+			Prewarmed++;
+		}
+	}
+}
+
+void URoomAbilityComponent::OnKatanaCollidedWithEnemy(AActor* OtherActor, const FHitResult& Hit)
+{
+	AEnemy* Enemy = Cast<AEnemy>(OtherActor);
+	if (Enemy && bIsInjectionShot)
+	{	
+		UpdateEnemyStatus(Enemy);
+
+		// a chain injection shot finishes when its last dash ends, a single one on its first hit
+		if (!bIsChainShot)
+		{
+			FinishInjectionShot();
 		}
 	}
 }
\ No newline at end of file
@@ -4,8 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "EnemyTargetScoring.h"
 #include "RoomAbilityComponent.generated.h"
 
+// an enemy killed this frame waiting for its rag doll death
+struct FPendingEnemyDeath
+{
+	TWeakObjectPtr<class AEnemy> Enemy;
+	FVector Impulse;
+};
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class LAWROOM_API URoomAbilityComponent : public UActorComponent
@@ -56,6 +63,10 @@ private:
 	UPROPERTY()
 	FLinearColor RoomBaseColor;
 
+	// created once, the room color is changed on it every frame of the room life
+	UPROPERTY()
+	class UMaterialInstanceDynamic* RoomDynamicMaterial = nullptr;
+
 	UPROPERTY()
 	class UTimelineComponent* SpawnRoomTimeline = nullptr;
 
@@ -65,6 +76,21 @@ private:
 	UPROPERTY()
 	TArray<class AEnemy*> Enemies;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// enemies farther than this (in cm) get no distance score when choosing the lock on target
+	float TargetScoringMaxDistance = 3000.f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// above this many enemies the target scoring runs in parallel
+	int32 ParallelTargetScoringThreshold = 1024;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup", meta = (ClampMin = "1", ClampMax = "180"))
+	// half angle (in degrees) of the view cone an enemy must be in to be seen by the player
+	float SightHalfAngle = 60.f;
+
+	// enemies snapshot used to score the lock on targets
+	mutable FEnemyTargetSnapshot TargetSnapshot;
+
 	// Toggle focus on and off
 	bool bIsFocused = false;
 
@@ -73,17 +99,87 @@ private:
 
 	// player character: owner
 	class ALawRoomCharacter* Player = nullptr;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup", meta = (ClampMin = "1"))
+	// maximum number of enemies locked by a chain injection shot
+	int32 MaxChainTargets = 5;
+
+	// enemies left to dash through in the current chain injection shot, in dash order
+	UPROPERTY()
+	TArray<class AEnemy*> ChainTargets;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Setup")
+	// gap (in cm) between the player and enemy capsules the end of a chain dash still kills its target across
+	float InjectionShotReach = 100.f;
+
+	// enemy of the dash in progress, killed when the dash ends in reach of it even if the katana missed it
+	UPROPERTY()
+	class AEnemy* DashedEnemy = nullptr;
+
+	bool bIsChainShot = false;
+
+	// deaths are processed together at the end of the frame
+	TArray<FPendingEnemyDeath> PendingDeaths;
+
+	// enemies in the room waiting for their rag doll to be prewarmed
+	TArray<TWeakObjectPtr<class AEnemy>> RagdollPrewarmQueue;
+
+	// enemies killed by this player whose rag doll still simulates, oldest first
+	TArray<TWeakObjectPtr<class AEnemy>> ActiveRagdolls;
+
+	// platform times of the last room cast and shot request, for the telemetry durations and latencies
+	double RoomCastTime = 0.0;
+	double ShotRequestTime = 0.0;
 	
 private:
-	// calculate the distance between the player and the LockedOnEnemy
-	float CalculateDistance(class AEnemy* Enemy) const;
-
 	// checks if the player is in the room to enable him to use his abilities
 	bool CheckPlayerInsideRoom(class ALawRoomCharacter* Player) const;
 
-	// Get the closest visible enemy to the player
+	// Get the best enemy to lock on: scored on distance, camera facing, visibility and threat
 	class AEnemy* GetClosestEnemy() const;
 
+	// fills Targets with up to MaxChainTargets visible enemies ordered by the shortest path from the player
+	void GetChainTargets(TArray<class AEnemy*>& Targets) const;
+
+	// the enemy is in the view cone of the player view point and no world static geometry hides it;
+	// unlike WasRecentlyRendered it works for bots and on the server, where nothing is rendered
+	bool IsEnemyInSight(const class AEnemy* Enemy, const FVector& ViewLocation, const FVector& ViewDirection) const;
+
+	// binds the room curves to the timelines, done once since every AddInterpFloat adds a new interp
+	void SetupTimelines();
+
+	// plays the injection shot animation and dashes to the enemy
+	void DashToEnemy(class AEnemy* Enemy);
+
+	// called when the injection dash ends: finishes a single shot, continues the chain if there are targets left
+	void OnInjectionDashEnded(const FHitResult& BlockingHit);
+
+	// the dash was stopped by the enemy, or left the player capsule within InjectionShotReach of its capsule
+	bool IsEnemyInReach(const class AEnemy* Enemy, const FHitResult& BlockingHit) const;
+
+	// stops the attack and gives the control back to the player
+	void FinishInjectionShot();
+
+	// the streamer of the arena cells, null when the arena is not streamed
+	class AArenaStreamer* GetArenaStreamer() const;
+
+	// the crowd of instanced enemies, null when the map has none or on clients
+	class AEnemyCrowd* GetEnemyCrowd() const;
+
+	float GetMsSinceShotRequest() const;
+
+	// collision changes, rag doll physics and impulses of all the enemies killed this frame
+	void ProcessPendingDeaths();
+
+	// prewarms the rag doll of the next LawRoom.Ragdoll.PrewarmsPerFrame enemies of the queue
+	void ProcessRagdollPrewarms();
+
+	// freezes the oldest rag dolls above LawRoom.Ragdoll.MaxActive, or drops and hides the ones still falling
+	void LimitActiveRagdolls();
+
+	// switches the room between RoomMaterial and its dynamic instance following LawRoom.Room.MaterialQuality
+	void UpdateRoomMaterial();
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
@@ -115,7 +211,7 @@ public:
 	void UpdateRoomColor(float Alpha);
 
 	// returns a dynamic Room material to be able change the color of the room over time
-	class UMaterialInstanceDynamic* GetRoomDynamicMaterial() const;
+	FORCEINLINE class UMaterialInstanceDynamic* GetRoomDynamicMaterial() const { return RoomDynamicMaterial; }
 
 	UFUNCTION()
 	void DestroyRoom();
@@ -124,9 +220,23 @@ public:
 	void OnRoomDetectedEnemy(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
 	UFUNCTION()
-	void OnKatanaCollidedWithEnemy(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	// only tells the AI scheduler, the enemies detected by the room stay targets until it is destroyed
+	void OnRoomLostEnemy(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	UFUNCTION()
+	// called by the katana hit detection when the blade sweep hits an actor during the injection shot hit window
+	void OnKatanaCollidedWithEnemy(AActor* OtherActor, const FHitResult& Hit);
 
 	FORCEINLINE class AEnemy* GetLockedOnEnemy() const { return LockedOnEnemy; }
+
+	// returns false when there is no room, otherwise the room sphere at its full radius
+	bool GetRoomSphere(FSphere& OutSphere) const;
+
+	// pawns that can own a room: the ones of player controllers and of room bots
+	static void GetRoomUsers(const UWorld* World, TArray<APawn*>& OutUsers);
+
+	// is the enemy in the room, locked on or part of the chain
+	bool IsEnemyInUse(const class AEnemy* Enemy) const;
 	FORCEINLINE bool GetIsFocused() const { return bIsFocused; }
 
 	// focus only when the player is in the room
@@ -140,10 +250,13 @@ public:
 	// check if the player can perform injection shot attack  if true calls the StartInjectionShot method from LawRoomCharacter
 	void RequestInjectionShot();
 
+	// locks up to MaxChainTargets enemies in the room and requests an injection shot that dashes through all of them
+	void RequestChainInjectionShot();
+
 	UFUNCTION(BlueprintCallable)
 	void InjectionShot();
 
-	// updates enemy death state and collision also enables rag doll death
+	// updates enemy death state and queues its collision and rag doll death for the end of the frame
 	void UpdateEnemyStatus(AEnemy* Enemy);
 
 	// used in animation blueprint